@@ -0,0 +1,99 @@
+#!/bin/bash
+# Parse every pdf of a directory with both text backends,
+# report time of each backend, speedup and whether outputs are identical,
+# differences of section tree (id, parent id, title) or of first differing section follow each file that differs
+# usage: compare_backends.sh path/to/pdf_reader pdf_directory
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 path/to/pdf_reader pdf_directory" >&2
+    exit 1
+fi
+
+PDF_READER="$1"
+PDF_DIRECTORY="$2"
+WORK_DIRECTORY="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIRECTORY"' EXIT
+
+# seconds since epoch with nanoseconds
+now() {
+    date +%s.%N
+}
+
+# number of sections in an output file
+count_sections() {
+    grep -o '"id":' "$1" | wc -l
+}
+
+# differences need jq to read sections
+if command -v jq > /dev/null 2>&1; then
+    HAVE_JQ=1
+else
+    HAVE_JQ=0
+    echo "jq not found, differences are not shown" >&2
+fi
+
+# 1 line per section: id, parent id and title
+section_tree() {
+    jq -r '.[] | "\(.id) \(.parent_id // "-") \(.title)"' "$1"
+}
+
+# diff of section trees, or of first differing section if trees are the same, lines are cut to 200 characters
+print_differences() {
+    local text_json="$1" glyph_json="$2" tree_diff
+    tree_diff=$(diff <(section_tree "$text_json") <(section_tree "$glyph_json"))
+    if [ -z "$tree_diff" ]; then
+        tree_diff=$(diff <(jq -c '.[]' "$text_json") <(jq -c '.[]' "$glyph_json") | awk '/^[0-9]/ && hunks++ {exit} {print}')
+    fi
+    echo "$tree_diff" | head -n 40 | cut -c 1-200 | sed 's/^/    /'
+}
+
+printf "%-40s %10s %10s %8s %10s %10s %s\n" "file" "text (s)" "glyph (s)" "speedup" "sections" "sections" "output"
+total_text=0
+total_glyph=0
+identical=0
+files=0
+
+for pdf in "$PDF_DIRECTORY"/*.pdf; do
+    [ -e "$pdf" ] || continue
+    name="$(basename "$pdf")"
+    cp "$pdf" "$WORK_DIRECTORY/$name"
+
+    start=$(now)
+    "$PDF_READER" --backend text "$WORK_DIRECTORY/$name" > /dev/null 2>&1
+    end=$(now)
+    mv "$WORK_DIRECTORY/$name.json" "$WORK_DIRECTORY/$name.text.json"
+    text_time=$(echo "$end - $start" | bc)
+
+    start=$(now)
+    "$PDF_READER" --backend glyph "$WORK_DIRECTORY/$name" > /dev/null 2>&1
+    end=$(now)
+    mv "$WORK_DIRECTORY/$name.json" "$WORK_DIRECTORY/$name.glyph.json"
+    glyph_time=$(echo "$end - $start" | bc)
+
+    if cmp -s "$WORK_DIRECTORY/$name.text.json" "$WORK_DIRECTORY/$name.glyph.json"; then
+        output="identical"
+        identical=$((identical + 1))
+    else
+        output="differs"
+    fi
+
+    printf "%-40s %10.3f %10.3f %7.2fx %10d %10d %s\n" "$name" "$text_time" "$glyph_time" \
+           "$(echo "$text_time / $glyph_time" | bc -l)" \
+           "$(count_sections "$WORK_DIRECTORY/$name.text.json")" "$(count_sections "$WORK_DIRECTORY/$name.glyph.json")" "$output"
+    if [ "$output" = "differs" ] && [ "$HAVE_JQ" -eq 1 ]; then
+        print_differences "$WORK_DIRECTORY/$name.text.json" "$WORK_DIRECTORY/$name.glyph.json"
+    fi
+
+    total_text=$(echo "$total_text + $text_time" | bc)
+    total_glyph=$(echo "$total_glyph + $glyph_time" | bc)
+    files=$((files + 1))
+    rm -f "$WORK_DIRECTORY/$name"
+done
+
+if [ "$files" -eq 0 ]; then
+    echo "No pdf in $PDF_DIRECTORY" >&2
+    exit 1
+fi
+
+printf "total: text %.3f s, glyph %.3f s, speedup %.2fx, identical output %d/%d\n" \
+       "$total_text" "$total_glyph" "$(echo "$total_text / $total_glyph" | bc -l)" "$identical" "$files"
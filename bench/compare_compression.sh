@@ -0,0 +1,84 @@
+#!/bin/bash
+# Parse every pdf of a directory with each output compression type and level,
+# report json throughput (uncompressed MB/s) and output size of each setting
+# usage: compare_compression.sh path/to/pdf_reader pdf_directory [level...]
+# levels apply to gzip and zstd, default is codec's default level
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 path/to/pdf_reader pdf_directory [level...]" >&2
+    exit 1
+fi
+
+PDF_READER="$1"
+PDF_DIRECTORY="$2"
+shift 2
+LEVELS=("$@")
+if [ ${#LEVELS[@]} -eq 0 ]; then
+    LEVELS=("default")
+fi
+WORK_DIRECTORY="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIRECTORY"' EXIT
+
+now() {
+    date +%s.%N
+}
+
+PDFS=("$PDF_DIRECTORY"/*.pdf)
+if [ ! -e "${PDFS[0]}" ]; then
+    echo "No pdf in $PDF_DIRECTORY" >&2
+    exit 1
+fi
+for pdf in "${PDFS[@]}"; do
+    cp "$pdf" "$WORK_DIRECTORY/"
+done
+
+# run_setting type level, print seconds and total output bytes of all pdfs
+run_setting() {
+    local type="$1" level="$2" extension=""
+    local level_args=()
+    if [ "$level" != "default" ]; then
+        level_args=(-l "$level")
+    fi
+    case "$type" in
+        gzip) extension=".gz" ;;
+        zstd) extension=".zst" ;;
+    esac
+
+    local start end bytes=0 size
+    start=$(now)
+    for pdf in "$WORK_DIRECTORY"/*.pdf; do
+        "$PDF_READER" -z "$type" "${level_args[@]}" "$pdf" > /dev/null 2>&1 || return 1
+    done
+    end=$(now)
+    for pdf in "$WORK_DIRECTORY"/*.pdf; do
+        size=$(wc -c < "$pdf.json$extension")
+        bytes=$((bytes + size))
+        rm -f "$pdf.json$extension"
+    done
+    echo "$start $end $bytes"
+}
+
+# uncompressed run gives json size that throughput of every setting is measured against
+read -r start end raw_bytes <<< "$(run_setting none default)"
+if [ -z "$raw_bytes" ]; then
+    echo "pdf_reader failed" >&2
+    exit 1
+fi
+
+printf "%-6s %8s %12s %14s %8s\n" "type" "level" "MB/s" "output bytes" "ratio"
+print_setting() {
+    awk -v type="$1" -v level="$2" -v start="$3" -v end="$4" -v bytes="$5" -v raw_bytes="$raw_bytes" 'BEGIN {
+        printf "%-6s %8s %12.2f %14d %8.3f\n", type, level, raw_bytes / 1048576 / (end - start), bytes, bytes / raw_bytes
+    }'
+}
+print_setting none - "$start" "$end" "$raw_bytes"
+
+for type in gzip zstd; do
+    for level in "${LEVELS[@]}"; do
+        if ! read -r start end bytes <<< "$(run_setting "$type" "$level")" || [ -z "$bytes" ]; then
+            echo "$type is not available in this build" >&2
+            break
+        fi
+        print_setting "$type" "$level" "$start" "$end" "$bytes"
+    done
+done
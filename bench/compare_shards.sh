@@ -0,0 +1,79 @@
+#!/bin/bash
+# Parse generated corpus files whole and split into page range shards stitched by merge,
+# check that both outputs are byte identical
+# usage: compare_shards.sh path/to/pdf_reader path/to/pdf_corpus_generator [shards]
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 path/to/pdf_reader path/to/pdf_corpus_generator [shards]" >&2
+    exit 1
+fi
+
+PDF_READER="$1"
+GENERATOR="$2"
+SHARDS="${3:-4}"
+WORK_DIRECTORY="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIRECTORY"' EXIT
+
+# pages blocks depth seed of each corpus file, small files have fewer pages than shards
+POINTS=(
+    "3 10 3 1"
+    "5 4 2 2"
+    "40 10 3 3"
+    "100 16 5 4"
+    "120 2 8 5"
+    "250 8 4 6"
+)
+
+failures=0
+for point in "${POINTS[@]}"; do
+    read -r pages blocks depth seed <<< "$point"
+    name="p${pages}_b${blocks}_d${depth}_s${seed}"
+    pdf="$WORK_DIRECTORY/$name.pdf"
+    "$GENERATOR" --pages "$pages" --blocks "$blocks" --depth "$depth" --seed "$seed" "$pdf" || exit 1
+
+    if ! "$PDF_READER" -o "$WORK_DIRECTORY/$name.full.json" "$pdf" 2> /dev/null; then
+        echo "$name: full parse failed"
+        failures=$((failures + 1))
+        continue
+    fi
+
+    # equal page ranges, last one ends at last page
+    shard_count=$((SHARDS < pages ? SHARDS : pages))
+    shard_pages=$(((pages + shard_count - 1) / shard_count))
+    shard_files=()
+    first_page=1
+    shard_failed=0
+    while [ "$first_page" -le "$pages" ]; do
+        last_page=$((first_page + shard_pages - 1))
+        if [ "$last_page" -gt "$pages" ]; then
+            last_page=$pages
+        fi
+        shard_file="$WORK_DIRECTORY/$name.$first_page-$last_page.shard.json"
+        if ! "$PDF_READER" --first-page "$first_page" --last-page "$last_page" -o "$shard_file" "$pdf" 2> /dev/null; then
+            shard_failed=1
+            break
+        fi
+        shard_files+=("$shard_file")
+        first_page=$((last_page + 1))
+    done
+
+    if [ "$shard_failed" -eq 1 ] || ! "$PDF_READER" merge -o "$WORK_DIRECTORY/$name.merged.json" "${shard_files[@]}" 2> /dev/null; then
+        echo "$name: shard parse or merge failed"
+        failures=$((failures + 1))
+        continue
+    fi
+
+    if cmp -s "$WORK_DIRECTORY/$name.full.json" "$WORK_DIRECTORY/$name.merged.json"; then
+        echo "$name: ${#shard_files[@]} shards, identical"
+    else
+        echo "$name: ${#shard_files[@]} shards, differs"
+        cmp "$WORK_DIRECTORY/$name.full.json" "$WORK_DIRECTORY/$name.merged.json"
+        failures=$((failures + 1))
+    fi
+done
+
+if [ "$failures" -gt 0 ]; then
+    echo "$failures of ${#POINTS[@]} files differ or failed" >&2
+    exit 1
+fi
+echo "All ${#POINTS[@]} files are identical"
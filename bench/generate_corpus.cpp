@@ -0,0 +1,611 @@
+/*
+ * Generate a synthetic pdf deterministically, without any input file, to measure how pdf_reader scales
+ * pages: number of pages, first 2 pages (title and contents) have no page number
+ * blocks: text blocks per page, paragraphs are shorter when there are more blocks
+ * depth: heading levels, each level has its own prefix, font and indent:
+ *   1. ALL UPPER, 1.2. bold, (a) italic, (iv) bold italic, - bullet, deeper levels repeat these styles,
+ *   they are told apart by their own font object since indent isn't part of title format
+ * fonts: number of distinct body font objects, paragraphs cycle through them
+ * seed: same arguments and seed always give the same file
+ * outline: write document outline (bookmarks) with an item per heading, to measure pdf_reader --outline
+ * Pages also have a running header, a numbered footer, bold keywords inside paragraphs, quoted titles,
+ * titles without prefix, lower case and too long emphasized text, to exercise every branch of extract_text_block_information
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+static const double PAGE_WIDTH = 612.0;
+static const double PAGE_HEIGHT = 792.0;
+static const double MARGIN_LEFT = 72.0;
+static const double BODY_TOP = 720.0;
+static const double BODY_BOTTOM = 90.0;
+static const double BODY_SIZE = 10.0;
+static const double LEADING = 12.0;
+static const double LEVEL_INDENT = 18.0;
+
+struct CorpusOptions {
+    int pages = 100;
+    int blocks_per_page = 10;
+    int heading_depth = 3;
+    int body_fonts = 4;
+    uint64_t seed = 1;
+    bool compress = true;
+    bool outline = false;
+    const char* output_path = nullptr;
+};
+
+// splitmix64, same sequence on every platform, unlike std distributions
+class CorpusRandom {
+    public:
+        explicit CorpusRandom(uint64_t seed) : state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        // [0, n)
+        int below(int n) {
+            return static_cast<int>(next() % static_cast<uint64_t>(n));
+        }
+
+        bool chance(int percent) {
+            return below(100) < percent;
+        }
+
+    private:
+        uint64_t state;
+};
+
+static const char* words[] = {
+    "agreement", "party", "obligation", "payment", "delivery", "notice", "term", "service", "provider", "customer",
+    "liability", "warranty", "schedule", "clause", "period", "invoice", "amount", "breach", "remedy", "dispute",
+    "confidential", "information", "data", "security", "access", "report", "review", "change", "request", "approval",
+    "termination", "renewal", "fee", "tax", "insurance", "property", "license", "right", "consent", "law"
+};
+static const int WORD_COUNT = sizeof(words) / sizeof(words[0]);
+
+struct FontSpec {
+    const char* base_font;
+    bool bold;
+    bool italic;
+};
+
+// body fonts cycle through regular faces, heading fonts are emphasized faces
+static const FontSpec body_font_specs[] = {
+    {"Helvetica", false, false}, {"Times-Roman", false, false}, {"Courier", false, false}
+};
+static const FontSpec level_font_specs[] = {
+    {"Helvetica-Bold", true, false}, {"Helvetica-Bold", true, false}, {"Times-Italic", false, true},
+    {"Times-BoldItalic", true, true}, {"Helvetica-Bold", true, false}
+};
+static const int LEVEL_STYLES = 5;
+
+// pdf objects by number, object 0 is unused
+class PdfWriter {
+    public:
+        int reserve() {
+            objects.emplace_back();
+            return static_cast<int>(objects.size()) - 1;
+        }
+
+        void set(int number, std::string body) {
+            objects[number] = std::move(body);
+        }
+
+        int add(std::string body) {
+            int number = reserve();
+            set(number, std::move(body));
+            return number;
+        }
+
+        int add_stream(const std::string& data, bool compress) {
+            std::string stream_data = data;
+            std::string filter;
+            if (compress) {
+                uLongf compressed_length = compressBound(data.size());
+                stream_data.resize(compressed_length);
+                compress2(reinterpret_cast<Bytef*>(&stream_data[0]), &compressed_length,
+                          reinterpret_cast<const Bytef*>(data.data()), data.size(), Z_BEST_SPEED);
+                stream_data.resize(compressed_length);
+                filter = " /Filter /FlateDecode";
+            }
+            return add("<< /Length " + std::to_string(stream_data.size()) + filter + " >>\nstream\n" + stream_data + "\nendstream");
+        }
+
+        bool write(std::ostream& output, int catalog, int info) {
+            std::vector<size_t> offsets(objects.size(), 0);
+            std::string header("%PDF-1.5\n%\xe2\xe3\xcf\xd3\n");
+            output << header;
+            size_t offset = header.size();
+            for (size_t i = 1; i < objects.size(); ++i) {
+                offsets[i] = offset;
+                std::string object = std::to_string(i) + " 0 obj\n" + objects[i] + "\nendobj\n";
+                output << object;
+                offset += object.size();
+            }
+
+            output << "xref\n0 " << objects.size() << "\n0000000000 65535 f \n";
+            for (size_t i = 1; i < objects.size(); ++i) {
+                char entry[21];
+                std::snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offsets[i]);
+                output << entry;
+            }
+            output << "trailer\n<< /Size " << objects.size() << " /Root " << catalog << " 0 R /Info " << info << " 0 R >>\n"
+                   << "startxref\n" << offset << "\n%%EOF\n";
+            return output.good();
+        }
+
+    private:
+        std::vector<std::string> objects = std::vector<std::string>(1);
+};
+
+// literal string, characters above 127 are WinAnsiEncoding codes
+static std::string pdf_string(const std::string& text) {
+    std::string result("(");
+    for (unsigned char c : text) {
+        if (c == '(' || c == ')' || c == '\\') {
+            result += '\\';
+            result += static_cast<char>(c);
+        } else if (c > 127) {
+            char escaped[5];
+            std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+            result += escaped;
+        } else {
+            result += static_cast<char>(c);
+        }
+    }
+    return result + ")";
+}
+
+static std::string format_number(double value) {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+}
+
+static int add_font(PdfWriter& writer, const FontSpec& spec) {
+    // descriptor gives weight and italic flag, glyph widths come from poppler's built-in metrics of the base 14 fonts
+    int flags = 32 | (spec.italic ? 64 : 0);
+    int descriptor = writer.add(std::string("<< /Type /FontDescriptor /FontName /") + spec.base_font +
+                                " /Flags " + std::to_string(flags) + " /FontBBox [-166 -225 1000 931] /ItalicAngle " +
+                                (spec.italic ? "-12" : "0") + " /Ascent 718 /Descent -207 /CapHeight 718 /StemV " +
+                                (spec.bold ? "140" : "80") + " /FontWeight " + (spec.bold ? "700" : "400") + " >>");
+    return writer.add(std::string("<< /Type /Font /Subtype /Type1 /BaseFont /") + spec.base_font +
+                      " /Encoding /WinAnsiEncoding /FontDescriptor " + std::to_string(descriptor) + " 0 R >>");
+}
+
+static std::string roman_numeral(int number) {
+    static const char* ones[] = {"", "i", "ii", "iii", "iv", "v", "vi", "vii", "viii", "ix"};
+    std::string result(number / 10, 'x');
+    return result + ones[number % 10];
+}
+
+// text run of a block in 1 font
+struct TextRun {
+    std::string font;
+    std::string text;
+};
+
+// block of text lines, each line is a list of runs
+struct TextLines {
+    std::vector<std::vector<TextRun>> lines;
+    std::string title;  // text of heading before its content, empty for paragraphs
+};
+
+// outline item of a heading, destination is top of its block
+struct OutlineEntry {
+    int level;
+    std::string title;
+    int page_object;
+    double top;
+};
+
+class CorpusGenerator {
+    public:
+        CorpusGenerator(const CorpusOptions& options) : options(options), random(options.seed) {
+            level_numbers.assign(options.heading_depth, 0);
+        }
+
+        bool generate(std::ostream& output) {
+            std::string resources = "<< /Font <<";
+            for (int i = 0; i < options.body_fonts; ++i) {
+                int font = add_font(writer, body_font_specs[i % 3]);
+                resources += " /B" + std::to_string(i) + " " + std::to_string(font) + " 0 R";
+            }
+            // 1 font object per level, keywords use /H0 and /H1 even if there are fewer levels
+            for (int i = 0; i < std::max(options.heading_depth, LEVEL_STYLES); ++i) {
+                int font = add_font(writer, level_font_specs[i % LEVEL_STYLES]);
+                resources += " /H" + std::to_string(i) + " " + std::to_string(font) + " 0 R";
+            }
+            resources += " >> >>";
+
+            pages_object = writer.reserve();
+            std::vector<int> page_objects;
+            for (int page = 1; page <= options.pages; ++page) {
+                page_objects.push_back(add_page(page, resources));
+            }
+
+            std::string kids;
+            for (int page_object : page_objects) {
+                kids += std::to_string(page_object) + " 0 R ";
+            }
+            writer.set(pages_object, "<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(options.pages) + " >>");
+            std::string outline;
+            if (options.outline && !outline_entries.empty()) {
+                outline = " /Outlines " + std::to_string(add_outline()) + " 0 R /PageMode /UseOutlines";
+            }
+            int catalog = writer.add("<< /Type /Catalog /Pages " + std::to_string(pages_object) + " 0 R" + outline + " >>");
+            int info = writer.add("<< /Title " + pdf_string("Synthetic corpus " + std::to_string(options.seed)) + " /Producer (pdf_corpus_generator) >>");
+            return writer.write(output, catalog, info);
+        }
+
+    private:
+        std::string random_words(int count, bool capitalize) {
+            std::string text;
+            for (int i = 0; i < count; ++i) {
+                if (i > 0) {
+                    text += ' ';
+                }
+                text += words[random.below(WORD_COUNT)];
+            }
+            if (capitalize && !text.empty()) {
+                text[0] = static_cast<char>(std::toupper(text[0]));
+            }
+            return text;
+        }
+
+        std::string heading_title(int level) {
+            std::string title = random_words(1 + random.below(4), true);
+            if (level % LEVEL_STYLES == 0) {
+                for (char& c : title) {
+                    c = static_cast<char>(std::toupper(c));
+                }
+            }
+            return title;
+        }
+
+        // prefix of next heading of a level, numbering of deeper levels restarts
+        std::string heading_prefix(int level) {
+            ++level_numbers[level];
+            for (size_t deeper = level + 1; deeper < level_numbers.size(); ++deeper) {
+                level_numbers[deeper] = 0;
+            }
+
+            int number = level_numbers[level];
+            switch (level % LEVEL_STYLES) {
+                case 0:
+                    return std::to_string(number) + ".";
+                case 1:
+                    return std::to_string(std::max(level_numbers[level - 1], 1)) + "." + std::to_string(number) + ".";
+                case 2:
+                    return std::string("(") + static_cast<char>('a' + (number - 1) % 26) + ")";
+                case 3:
+                    return "(" + roman_numeral((number - 1) % 18 + 1) + ")";
+                default:
+                    return "-";
+            }
+        }
+
+        // words of body text wrapped to lines of the page width, some words are bold keywords
+        void append_paragraph(TextLines& block, std::vector<TextRun>& line, double& line_width, double indent,
+                              const std::string& body_font, int word_count) {
+            double max_width = PAGE_WIDTH - MARGIN_LEFT - indent - 72.0;
+            for (int i = 0; i < word_count; ++i) {
+                std::string word = words[random.below(WORD_COUNT)];
+                std::string font = body_font;
+                if (random.chance(4)) {
+                    // keyword, lower case emphasized text inside content
+                    font = "/H0";
+                }
+                if (random.chance(2)) {
+                    word = "\x93" + word + "\x94";
+                }
+
+                // 0.6 of font size is wider than average glyph of all fonts used
+                double word_width = (word.size() + 1) * BODY_SIZE * 0.6;
+                if (line_width + word_width > max_width && !line.empty()) {
+                    block.lines.push_back(std::move(line));
+                    line.clear();
+                    line_width = 0;
+                }
+                if (!line.empty() && line.back().font == font) {
+                    line.back().text += " " + word;
+                } else {
+                    line.push_back(TextRun{font, (line.empty() ? "" : " ") + word});
+                }
+                line_width += word_width;
+            }
+        }
+
+        TextLines heading_block(int level, double indent, const std::string& body_font, int word_count) {
+            TextLines block;
+            std::vector<TextRun> line;
+            double line_width = 0;
+            std::string title_font = "/H" + std::to_string(level);
+            std::string title = heading_title(level);
+            int variant = random.below(10);
+
+            if (variant == 0) {
+                // quoted title after prefix
+                line.push_back(TextRun{body_font, heading_prefix(level) + " '"});
+                line.push_back(TextRun{title_font, title});
+                line.push_back(TextRun{body_font, "'"});
+            } else if (variant == 1) {
+                line.push_back(TextRun{body_font, heading_prefix(level) + " \""});
+                line.push_back(TextRun{title_font, title});
+                line.push_back(TextRun{body_font, "\""});
+            } else if (variant == 2) {
+                // quoted title without prefix
+                line.push_back(TextRun{body_font, "'"});
+                line.push_back(TextRun{title_font, title});
+                line.push_back(TextRun{body_font, "'"});
+            } else if (variant == 3) {
+                // title without prefix, content continues after colon
+                line.push_back(TextRun{title_font, title});
+                line.push_back(TextRun{body_font, ":"});
+            } else if (variant == 4) {
+                // title alone in its block
+                line.push_back(TextRun{title_font, title});
+                block.title = title;
+                block.lines.push_back(std::move(line));
+                return block;
+            } else {
+                line.push_back(TextRun{body_font, heading_prefix(level) + " "});
+                line.push_back(TextRun{title_font, title});
+            }
+
+            for (const TextRun& run : line) {
+                block.title += run.text;
+            }
+            line_width = (title.size() + 8) * BODY_SIZE * 0.6;
+            append_paragraph(block, line, line_width, indent, body_font, word_count);
+            if (!line.empty()) {
+                block.lines.push_back(std::move(line));
+            }
+            return block;
+        }
+
+        TextLines paragraph_block(double indent, const std::string& body_font, int word_count) {
+            TextLines block;
+            std::vector<TextRun> line;
+            double line_width = 0;
+            int variant = random.below(40);
+            if (variant == 0) {
+                // lower case emphasized text at beginning isn't a title
+                line.push_back(TextRun{"/H1", random_words(2, false)});
+                line_width = 20 * BODY_SIZE * 0.6;
+            } else if (variant == 1) {
+                // emphasized text longer than title max length isn't a title
+                line.push_back(TextRun{"/H1", random_words(16, true)});
+                block.lines.push_back(std::move(line));
+                line.clear();
+            }
+            append_paragraph(block, line, line_width, indent, body_font, word_count);
+            if (!line.empty()) {
+                block.lines.push_back(std::move(line));
+            }
+            return block;
+        }
+
+        void draw_block(std::string& content, const TextLines& block, double x, double y) {
+            content += "BT " + format_number(LEADING) + " TL " + format_number(x) + " " + format_number(y) + " Td\n";
+            for (size_t l = 0; l < block.lines.size(); ++l) {
+                if (l > 0) {
+                    content += "T*\n";
+                }
+                for (const TextRun& run : block.lines[l]) {
+                    content += run.font + " " + format_number(BODY_SIZE) + " Tf " + pdf_string(run.text) + " Tj\n";
+                }
+            }
+            content += "ET\n";
+        }
+
+        void draw_text(std::string& content, const std::string& font, double size, double x, double y, const std::string& text) {
+            content += "BT " + font + " " + format_number(size) + " Tf " + format_number(x) + " " + format_number(y) + " Td " +
+                       pdf_string(text) + " Tj ET\n";
+        }
+
+        int add_page(int page, const std::string& resources) {
+            // page object is numbered first, outline destinations of its headings refer to it
+            int page_object = writer.reserve();
+            std::string content;
+
+            // running header is plain text repeated on every page, it ends up in content of current section
+            draw_text(content, "/B0", 8, MARGIN_LEFT, PAGE_HEIGHT - 40, "Synthetic corpus " + std::to_string(options.seed) + " - confidential");
+
+            if (page == 1) {
+                draw_text(content, "/H0", 20, MARGIN_LEFT, BODY_TOP - 100, "SYNTHETIC CORPUS DOCUMENT");
+                draw_text(content, "/B0", 12, MARGIN_LEFT, BODY_TOP - 130, random_words(8, true));
+            } else if (page == 2) {
+                // contents, before first page number, nothing is assembled
+                draw_text(content, "/H0", 14, MARGIN_LEFT, BODY_TOP, "CONTENTS");
+                for (int i = 0; i < 20; ++i) {
+                    draw_text(content, "/B0", BODY_SIZE, MARGIN_LEFT, BODY_TOP - 30 - i * LEADING * 1.5,
+                              std::to_string(i + 1) + ". " + random_words(3, true) + " ...... " + std::to_string(3 + i));
+                }
+            } else {
+                // same density on every page: each block gets an equal share of body height
+                double block_height = (BODY_TOP - BODY_BOTTOM) / options.blocks_per_page;
+                int max_lines = std::max(1, static_cast<int>(block_height / LEADING) - 1);
+                double y = BODY_TOP;
+                for (int b = 0; b < options.blocks_per_page; ++b) {
+                    std::string body_font = "/B" + std::to_string(paragraph_count++ % options.body_fonts);
+                    int word_count = std::max(2, max_lines * 9 - random.below(9));
+                    TextLines block;
+                    double indent = 0;
+                    if (random.chance(25)) {
+                        current_level = next_heading_level();
+                        indent = current_level * LEVEL_INDENT;
+                        block = heading_block(current_level, indent, body_font, word_count / 2);
+                    } else {
+                        indent = (current_level + 1) * LEVEL_INDENT;
+                        block = paragraph_block(indent, body_font, word_count);
+                    }
+                    if (static_cast<int>(block.lines.size()) > max_lines) {
+                        block.lines.resize(max_lines);
+                    }
+                    if (!block.title.empty()) {
+                        outline_entries.push_back(OutlineEntry{current_level, block.title, page_object, y + BODY_SIZE});
+                    }
+                    draw_block(content, block, MARGIN_LEFT + std::min(indent, 180.0), y);
+                    y -= block_height;
+                }
+            }
+
+            // numbered footer in bottom 60 points, formats all match page number regex
+            if (page > 2) {
+                static const char* footer_formats[] = {"%d", "- %d -", "(%d)", "%d."};
+                char footer[32];
+                std::snprintf(footer, sizeof(footer), footer_formats[(page / 10) % 4], page - 2);
+                draw_text(content, "/B0", 9, PAGE_WIDTH / 2, 30, footer);
+            }
+
+            int contents = writer.add_stream(content, options.compress);
+            writer.set(page_object, "<< /Type /Page /Parent " + std::to_string(pages_object) + " 0 R /MediaBox [0 0 " +
+                       format_number(PAGE_WIDTH) + " " + format_number(PAGE_HEIGHT) + "] /Resources " + resources +
+                       " /Contents " + std::to_string(contents) + " 0 R >>");
+            return page_object;
+        }
+
+        // outline tree of headings in document order, every item is open, return outline dictionary
+        int add_outline() {
+            size_t count = outline_entries.size();
+            int outlines = writer.reserve();
+            std::vector<int> objects(count);
+            for (size_t i = 0; i < count; ++i) {
+                objects[i] = writer.reserve();
+            }
+
+            // index of parent, siblings and children of each item, -1 if there is none, parent -1 is outline dictionary
+            std::vector<int> parents(count, -1), previous(count, -1), next(count, -1), first(count, -1), last(count, -1);
+            std::vector<int> descendants(count, 0);
+            int root_first = -1, root_last = -1;
+            std::vector<int> open_items;
+            for (size_t i = 0; i < count; ++i) {
+                size_t level = std::min(static_cast<size_t>(outline_entries[i].level), open_items.size());
+                open_items.resize(level);
+                int parent = open_items.empty() ? -1 : open_items.back();
+                int& first_child = parent < 0 ? root_first : first[parent];
+                int& last_child = parent < 0 ? root_last : last[parent];
+                if (last_child >= 0) {
+                    previous[i] = last_child;
+                    next[last_child] = static_cast<int>(i);
+                } else {
+                    first_child = static_cast<int>(i);
+                }
+                last_child = static_cast<int>(i);
+                parents[i] = parent;
+                for (int ancestor = parent; ancestor >= 0; ancestor = parents[ancestor]) {
+                    ++descendants[ancestor];
+                }
+                open_items.push_back(static_cast<int>(i));
+            }
+
+            auto reference = [&](int item) {
+                return std::to_string(item < 0 ? outlines : objects[item]) + " 0 R";
+            };
+            for (size_t i = 0; i < count; ++i) {
+                const OutlineEntry& entry = outline_entries[i];
+                std::string item = "<< /Title " + pdf_string(entry.title) + " /Parent " + reference(parents[i]);
+                if (previous[i] >= 0) {
+                    item += " /Prev " + reference(previous[i]);
+                }
+                if (next[i] >= 0) {
+                    item += " /Next " + reference(next[i]);
+                }
+                if (first[i] >= 0) {
+                    item += " /First " + reference(first[i]) + " /Last " + reference(last[i]) +
+                            " /Count " + std::to_string(descendants[i]);
+                }
+                item += " /Dest [" + std::to_string(entry.page_object) + " 0 R /XYZ " + format_number(MARGIN_LEFT) + " " +
+                        format_number(entry.top) + " null] >>";
+                writer.set(objects[i], item);
+            }
+            writer.set(outlines, "<< /Type /Outlines /First " + reference(root_first) + " /Last " + reference(root_last) +
+                       " /Count " + std::to_string(count) + " >>");
+            return outlines;
+        }
+
+        // headings go 1 level deeper at most, or back up to any level
+        int next_heading_level() {
+            if (!any_heading) {
+                any_heading = true;
+                return 0;
+            }
+            int choice = random.below(3);
+            if (choice == 0 && current_level + 1 < options.heading_depth) {
+                return current_level + 1;
+            } else if (choice == 1 && current_level > 0) {
+                return random.below(current_level + 1);
+            }
+            return current_level;
+        }
+
+        const CorpusOptions& options;
+        CorpusRandom random;
+        PdfWriter writer;
+        int pages_object = 0;
+        std::vector<int> level_numbers;
+        int current_level = 0;
+        bool any_heading = false;
+        int paragraph_count = 0;
+        std::vector<OutlineEntry> outline_entries;
+};
+
+static void print_usage(const char* program_name) {
+    std::cerr << "Usage: " << program_name << " [--pages n] [--blocks n] [--depth n] [--fonts n] [--seed n] [--no-compress] [--outline] output.pdf" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+            options.pages = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            options.blocks_per_page = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options.heading_depth = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--fonts") == 0 && i + 1 < argc) {
+            options.body_fonts = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--no-compress") == 0) {
+            options.compress = false;
+        } else if (std::strcmp(argv[i], "--outline") == 0) {
+            options.outline = true;
+        } else if (!options.output_path) {
+            options.output_path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!options.output_path || options.pages < 1 || options.blocks_per_page < 1 || options.heading_depth < 1 || options.body_fonts < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream output(options.output_path, std::ios::binary);
+    CorpusGenerator generator(options);
+    if (!generator.generate(output)) {
+        std::cerr << "Failed to write " << options.output_path << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
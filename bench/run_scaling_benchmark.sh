@@ -0,0 +1,103 @@
+#!/bin/bash
+# Generate synthetic corpus sweeps and run pdf_reader on each point,
+# write pages/sec, MB/s and peak RSS of every point to a csv file, one curve per swept parameter,
+# outline sweep compares heuristic sections with sections from document outline (--outline) at base point
+# usage: run_scaling_benchmark.sh path/to/pdf_reader path/to/pdf_corpus_generator output_directory [pdf_reader args...]
+
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 path/to/pdf_reader path/to/pdf_corpus_generator output_directory [pdf_reader args...]" >&2
+    exit 1
+fi
+
+PDF_READER="$1"
+GENERATOR="$2"
+OUTPUT_DIRECTORY="$3"
+shift 3
+PDF_READER_ARGS=("$@")
+
+# base point, each sweep varies 1 parameter from it
+BASE_PAGES=100
+BASE_BLOCKS=10
+BASE_DEPTH=3
+BASE_FONTS=4
+SEED=1
+
+PAGES_SWEEP="10 50 100 250 500 1000"
+BLOCKS_SWEEP="2 4 8 12 16 24"
+DEPTH_SWEEP="1 2 3 4 5 8"
+FONTS_SWEEP="1 2 4 8 16 32"
+OUTLINE_SWEEP="0 1"
+
+mkdir -p "$OUTPUT_DIRECTORY/corpus" || exit 1
+RESULTS="$OUTPUT_DIRECTORY/scaling.csv"
+
+# peak RSS needs GNU time
+if /usr/bin/time -f "%M" true > /dev/null 2>&1; then
+    HAVE_GNU_TIME=1
+else
+    HAVE_GNU_TIME=0
+    echo "GNU time not found, peak RSS is not measured" >&2
+fi
+
+now() {
+    date +%s.%N
+}
+
+# run_point sweep value pages blocks depth fonts [outline]
+run_point() {
+    local sweep="$1" value="$2" pages="$3" blocks="$4" depth="$5" fonts="$6" outline="${7:-0}"
+    local pdf="$OUTPUT_DIRECTORY/corpus/p${pages}_b${blocks}_d${depth}_f${fonts}_s${SEED}.pdf"
+    local outline_args=()
+    if [ "$outline" -eq 1 ]; then
+        pdf="${pdf%.pdf}_outline.pdf"
+        outline_args=(--outline)
+    fi
+
+    # corpus is deterministic, generate each point once
+    if [ ! -e "$pdf" ]; then
+        "$GENERATOR" --pages "$pages" --blocks "$blocks" --depth "$depth" --fonts "$fonts" --seed "$SEED" "${outline_args[@]}" "$pdf" || exit 1
+    fi
+    local bytes
+    bytes=$(wc -c < "$pdf")
+
+    local start end peak_rss="n/a"
+    start=$(now)
+    if [ "$HAVE_GNU_TIME" -eq 1 ]; then
+        /usr/bin/time -f "%M" -o "$OUTPUT_DIRECTORY/peak_rss" "$PDF_READER" "${PDF_READER_ARGS[@]}" "${outline_args[@]}" "$pdf" > /dev/null 2>&1
+        peak_rss=$(tail -n 1 "$OUTPUT_DIRECTORY/peak_rss")
+    else
+        "$PDF_READER" "${PDF_READER_ARGS[@]}" "${outline_args[@]}" "$pdf" > /dev/null 2>&1
+    fi
+    end=$(now)
+    rm -f "$pdf".json* "$OUTPUT_DIRECTORY/peak_rss"
+
+    awk -v sweep="$sweep" -v value="$value" -v pages="$pages" -v blocks="$blocks" -v depth="$depth" -v fonts="$fonts" \
+        -v bytes="$bytes" -v start="$start" -v end="$end" -v peak_rss="$peak_rss" -v results="$RESULTS" 'BEGIN {
+        seconds = end - start
+        pages_per_second = pages / seconds
+        mb_per_second = bytes / 1048576 / seconds
+        printf "%s,%s,%d,%d,%d,%d,%d,%.4f,%.2f,%.3f,%s\n", sweep, value, pages, blocks, depth, fonts, bytes,
+               seconds, pages_per_second, mb_per_second, peak_rss >> results
+        printf "%-7s %6s %10.2f pages/s %10.3f MB/s %12s KB peak RSS\n", sweep, value, pages_per_second, mb_per_second, peak_rss
+    }'
+}
+
+echo "sweep,value,pages,blocks_per_page,heading_depth,body_fonts,bytes,seconds,pages_per_second,mb_per_second,peak_rss_kb" > "$RESULTS"
+
+for pages in $PAGES_SWEEP; do
+    run_point pages "$pages" "$pages" "$BASE_BLOCKS" "$BASE_DEPTH" "$BASE_FONTS"
+done
+for blocks in $BLOCKS_SWEEP; do
+    run_point blocks "$blocks" "$BASE_PAGES" "$blocks" "$BASE_DEPTH" "$BASE_FONTS"
+done
+for depth in $DEPTH_SWEEP; do
+    run_point depth "$depth" "$BASE_PAGES" "$BASE_BLOCKS" "$depth" "$BASE_FONTS"
+done
+for fonts in $FONTS_SWEEP; do
+    run_point fonts "$fonts" "$BASE_PAGES" "$BASE_BLOCKS" "$BASE_DEPTH" "$fonts"
+done
+for outline in $OUTLINE_SWEEP; do
+    run_point outline "$outline" "$BASE_PAGES" "$BASE_BLOCKS" "$BASE_DEPTH" "$BASE_FONTS" "$outline"
+done
+
+echo "Results written to $RESULTS"
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ostream>
+
+// pipeline stage that allocations are attributed to, set per thread
+enum class AllocStage {OTHER, LAYOUT, EXTRACTION, SECTION_ASSEMBLY, TREE_BUILD, SERIALIZATION, COUNT};
+
+#ifdef PDF_READER_ALLOC_PROFILING
+
+// set stage of current thread while in scope, previous stage is restored at the end
+class AllocStageScope {
+    public:
+        explicit AllocStageScope(AllocStage stage);
+
+        ~AllocStageScope();
+
+        AllocStageScope(const AllocStageScope&) = delete;
+
+        AllocStageScope& operator=(const AllocStageScope&) = delete;
+
+    private:
+        AllocStage previous_stage;
+};
+
+// allocations of current thread are counted to this page until next call, 0 = no page
+void alloc_profiler_set_page(int page);
+
+// json report: allocations, bytes and peak live bytes per stage, allocations and bytes per stage of each page
+bool write_alloc_report(std::ostream& output);
+
+#else
+
+class AllocStageScope {
+    public:
+        explicit AllocStageScope(AllocStage) {}
+};
+
+inline void alloc_profiler_set_page(int) {}
+
+inline bool write_alloc_report(std::ostream&) {
+    return false;
+}
+
+#endif
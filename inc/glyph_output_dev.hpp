@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <poppler-config.h>
+#include <goo/GooString.h>
+#include <OutputDev.h>
+#include <GfxState.h>
+#include <GfxFont.h>
+#include <CharTypes.h>
+
+#ifndef GLYPH_WORD_BREAK_SPACE
+#define GLYPH_WORD_BREAK_SPACE 0.1  // gap between glyphs, in font size, that starts a new word, same as TextOutputDev
+#endif
+
+#ifndef GLYPH_LINE_BASELINE_DELTA
+#define GLYPH_LINE_BASELINE_DELTA 0.5  // baseline shift, in font size, that starts a new line
+#endif
+
+#ifndef GLYPH_BLOCK_LINE_SPACING
+#define GLYPH_BLOCK_LINE_SPACING 1.5  // baseline distance, in font size, that starts a new block
+#endif
+
+#ifndef GLYPH_BLOCK_FONT_SIZE_DELTA
+#define GLYPH_BLOCK_FONT_SIZE_DELTA 0.2  // relative font size change that starts a new block
+#endif
+
+struct GlyphPage;
+
+// same members as TextFontInfo that are used by extraction
+struct GlyphFontInfo {
+    GfxFont* gfxFont;
+
+    GBool isItalic() const {
+        return gfxFont && gfxFont->isItalic();
+    }
+};
+
+// word, line and block are index ranges into glyph arrays of their page,
+// they are stored contiguously so getNext is a pointer increment,
+// accessors have the same names as TextWord, TextLine and TextBlock
+class GlyphWord {
+    public:
+        GlyphWord* getNext() {
+            return last ? nullptr : this + 1;
+        }
+
+        int getLength() const {
+            return static_cast<int>(glyph_count);
+        }
+
+        const Unicode* getChar(int i) const;
+
+        GlyphFontInfo* getFontInfo(int i) const;
+
+        void getCharBBox(int i, double* xMin, double* yMin, double* xMax, double* yMax) const;
+
+        // UTF-8 text of word, caller deletes it
+        GooString* getText() const;
+
+        GlyphPage* page;
+        uint32_t first_glyph;
+        uint32_t glyph_count;
+        bool last;
+};
+
+class GlyphLine {
+    public:
+        GlyphLine* getNext() {
+            return last ? nullptr : this + 1;
+        }
+
+        GlyphWord* getWords();
+
+        GlyphPage* page;
+        uint32_t first_word;
+        double base;
+        double font_size;
+        double xMin, xMax;
+        bool last;
+};
+
+class GlyphBlock {
+    public:
+        GlyphBlock* getNext() {
+            return last ? nullptr : this + 1;
+        }
+
+        GlyphLine* getLines();
+
+        int getLineCount() const {
+            return static_cast<int>(line_count);
+        }
+
+        void getBBox(double* xMinA, double* yMinA, double* xMaxA, double* yMaxA) const {
+            *xMinA = xMin;
+            *yMinA = yMin;
+            *xMaxA = xMax;
+            *yMaxA = yMax;
+        }
+
+        GlyphPage* page;
+        uint32_t first_line;
+        uint32_t line_count;
+        double xMin, yMin, xMax, yMax;
+        bool last;
+};
+
+// glyphs of 1 page as structure of arrays, in content stream order, coordinates are upside down like TextOutputDev
+struct GlyphPage {
+    std::vector<double> x_min, y_min, x_max, y_max;
+    std::vector<double> base;
+    std::vector<double> font_size;
+    std::vector<Unicode> unicode;
+    std::vector<uint32_t> font;  // index to fonts
+    std::vector<uint8_t> space_before;  // a space glyph was drawn before this glyph
+
+    std::vector<GlyphFontInfo> fonts;
+    std::vector<GlyphWord> words;
+    std::vector<GlyphLine> lines;
+    std::vector<GlyphBlock> blocks;
+
+    GlyphBlock* getBlocks() {
+        return blocks.empty() ? nullptr : &blocks.front();
+    }
+
+    void clear();
+};
+
+// collect glyphs only, without TextOutputDev's reading order analysis,
+// glyphs are grouped into words, lines and blocks in content stream order when page ends
+class GlyphCollectorOutputDev : public OutputDev {
+    public:
+        GlyphCollectorOutputDev();
+
+        ~GlyphCollectorOutputDev();
+
+        GBool upsideDown() override {
+            return gTrue;
+        }
+
+        GBool useDrawChar() override {
+            return gTrue;
+        }
+
+        GBool interpretType3Chars() override {
+            return gFalse;
+        }
+
+        // images, shadings and paths aren't needed
+        GBool needNonText() override {
+            return gFalse;
+        }
+
+        void startPage(int pageNum, GfxState* state, XRef* xref) override;
+
+        void endPage() override;
+
+        void drawChar(GfxState* state, double x, double y, double dx, double dy, double originX, double originY,
+                      CharCode code, int nBytes, Unicode* u, int uLen) override;
+
+        // glyphs of last displayed page, valid until next page is displayed
+        GlyphPage& getPage() {
+            return page;
+        }
+
+    private:
+        void group_glyphs();
+
+        // index of font in page's font table, font is referenced until page is cleared
+        uint32_t font_index(GfxFont* gfx_font);
+
+        GlyphPage page;
+        GfxFont* current_font = nullptr;
+        uint32_t current_font_index = 0;
+        bool pending_space = false;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef OUTPUT_COMPRESSION_CHUNK_SIZE
+#define OUTPUT_COMPRESSION_CHUNK_SIZE (256 * 1024)
+#endif
+
+#ifndef OUTPUT_COMPRESSION_MAX_PENDING_CHUNKS
+#define OUTPUT_COMPRESSION_MAX_PENDING_CHUNKS 4
+#endif
+
+enum class CompressionType {NONE, GZIP, ZSTD};
+
+// codec used by CompressedOutputBuffer, one instance per output stream
+class OutputCompressor {
+    public:
+        virtual ~OutputCompressor() = default;
+
+        // compress data and write compressed bytes to sink, finish = true ends the compressed stream
+        virtual bool compress(const char* data, size_t length, bool finish, std::ostream& sink) = 0;
+};
+
+// streambuf that hands filled chunks to a compression thread,
+// so serialization keeps running while previous chunks are compressed and written
+class CompressedOutputBuffer : public std::streambuf {
+    public:
+        CompressedOutputBuffer(std::ostream& sink, std::unique_ptr<OutputCompressor> compressor);
+
+        ~CompressedOutputBuffer();
+
+        // submit buffered data, end compressed stream and wait for compression thread
+        bool close();
+
+    protected:
+        int_type overflow(int_type ch) override;
+
+        int sync() override;
+
+    private:
+        struct Chunk {
+            std::vector<char> data;
+            bool finish = false;
+        };
+
+        void submit_chunk(bool finish);
+
+        void compression_worker();
+
+        std::ostream& sink;
+        std::unique_ptr<OutputCompressor> compressor;
+        std::vector<char> buffer;
+        std::deque<Chunk> pending_chunks;
+        std::deque<std::vector<char>> free_buffers;
+        std::mutex chunks_mutex;
+        std::condition_variable chunks_condition;
+        std::atomic<bool> failed{false};
+        bool closed = false;
+        std::thread worker;
+};
+
+// parse compression name given in command line: none, gzip, zstd
+std::optional<CompressionType> parse_compression_type(const std::string& name);
+
+// level is codec specific, use codec's default level if not set, return nullptr if codec isn't available
+std::unique_ptr<OutputCompressor> create_output_compressor(CompressionType type, std::optional<int> level);
+
+// suffix to append to output file name
+const char* compression_file_extension(CompressionType type);
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <list>
+#include <ostream>
 #include <string>
+#include <vector>
 #include <memory>
 #include <optional>
 #include <regex>
@@ -29,12 +32,23 @@
 #include <Page.h>
 #include <PDFDocFactory.h>
 #include <GfxFont.h>
+#include <Outline.h>
+#include <Link.h>
 #include <nlohmann/json.hpp>
+#include "glyph_output_dev.hpp"
 
 #ifndef TITLE_FORMAT_INDENT_DELTA
 #define TITLE_FORMAT_INDENT_DELTA 0.2
 #endif
 
+#ifndef PARSE_STATE_VERSION
+#define PARSE_STATE_VERSION 3
+#endif
+
+#ifndef PDF_SHARD_VERSION
+#define PDF_SHARD_VERSION 2
+#endif
+
 static const char *fontTypeNames[] = {
   "unknown",
   "Type 1",
@@ -67,14 +81,6 @@ struct TitleFormat {
 
         TitleFormat();
 
-        TitleFormat(const TitleFormat& other);
-
-        TitleFormat(TitleFormat&& other);
-
-        TitleFormat& operator=(const TitleFormat& other);
-
-        TitleFormat& operator=(TitleFormat&& other);
-
         bool operator==(const TitleFormat& title_format);
 
         bool operator!=(const TitleFormat& title_format);
@@ -89,18 +95,110 @@ struct TextBlockInformation {
     std::string partial_paragraph_content;
 };
 
+// section content kept as the text block contents it is made of, flattened only when serialized
+class SectionContent {
+    public:
+        SectionContent& operator=(std::string text);
+
+        // text is moved in, callers give up their block content instead of copying it
+        void append(std::string&& text);
+
+        void append(SectionContent&& other);
+
+        // trim whitespace at both ends of the whole content
+        void trim();
+
+        size_t length() const;
+
+        std::string str() const;
+
+    private:
+        std::vector<std::string> chunks;
+        size_t content_length = 0;
+};
+
+// move only, sections are moved into PDFDocument when next title starts
 struct PDFSection {
     unsigned int id;
     std::string title;
     TitleFormat title_format;
-    std::string content;
+    SectionContent content;
     std::list<std::string> emphasized_words;
+
+    PDFSection() = default;
+
+    PDFSection(PDFSection&& other) = default;
+
+    PDFSection& operator=(PDFSection&& other) = default;
+
+    PDFSection(const PDFSection& other) = delete;
+
+    PDFSection& operator=(const PDFSection& other) = delete;
 };
 
 struct PDFDocument {
     std::list<PDFSection> sections;
 };
 
+// text blocks extracted from 1 page, kept to reuse in incremental reparse
+struct PageExtraction {
+    uint64_t fingerprint = 0;  // hash of xref entries of objects used by the page
+    bool start_parse = false;  // start_parse at the beginning of the page
+    std::list<TextBlockInformation> text_blocks;
+};
+
+// TEXT_OUTPUT_DEV: poppler's TextOutputDev, blocks in reading order
+// GLYPH_COLLECTOR: GlyphCollectorOutputDev, blocks in content stream order, skips flow and reading order analysis
+enum class TextBackend {TEXT_OUTPUT_DEV, GLYPH_COLLECTOR};
+
+// identity of a document revision, page fingerprints are only compared within the same document
+struct DocumentRevision {
+    std::string document_id;  // hex of first string of trailer /ID, kept by incremental updates
+    std::string revision_id;  // hex of second string of trailer /ID, changes when document is modified
+    int64_t start_xref = 0;  // offset of last xref section
+    int64_t previous_start_xref = 0;  // /Prev of last trailer, start_xref of previous revision, not saved
+};
+
+// state saved from previous run, to reparse next revision of incrementally updated pdf
+struct ParseState {
+    // blocks of pages depend on backend, state of another backend isn't reused
+    TextBackend backend = TextBackend::TEXT_OUTPUT_DEV;
+    DocumentRevision revision;  // revision the state was saved from
+    std::vector<PageExtraction> pages;
+    unsigned int extracted_pages = 0;  // not saved, number of pages extracted by poppler in last run
+};
+
+struct ParseOptions {
+    // reuse pages whose objects are unchanged since previous run, then replaced by state of this run
+    ParseState* incremental_state = nullptr;
+
+    // build sections from document outline if it is complete, heuristics are used otherwise
+    bool use_outline = false;
+
+    // if either is set, parse pages [first_page, last_page] only and write a PDFShard, 0 means first/last page of document
+    int first_page = 0;
+    int last_page = 0;
+
+    // output device that collects text of pages
+    TextBackend backend = TextBackend::TEXT_OUTPUT_DEV;
+};
+
+// partial result of a page range, shards of a document are stitched by merge_pdf_shards
+struct PDFShard {
+    TextBackend backend = TextBackend::TEXT_OUTPUT_DEV;  // shards of different backends can't be merged
+    int first_page = 1;
+    int last_page = 0;
+    int number_of_pages = 0;
+    std::string document_title;
+    // blocks of pages before first page number of the shard, assembled only if an earlier shard reached start_parse
+    std::list<TextBlockInformation> pending_text_blocks;
+    bool start_parse = false;  // a page number was found in the shard
+    // content and keywords before first title of the shard, they continue the section left open by earlier shards
+    PDFSection leading_section;
+    std::list<PDFSection> sections;  // sections started and finished in the shard
+    PDFSection trailing_section;  // section still open at end of the shard, title is empty if shard has no title
+};
+
 struct DocumentNode {
     PDFSection* main_section;
     std::optional<std::list<DocumentNode>> sub_sections;
@@ -154,17 +252,60 @@ inline bool is_all_lower_case(std::string& s) {
 }
 
 // convert Unicode character to UTF-8 encoded string
-inline std::string UnicodeToUTF8(Unicode codepoint);
+inline std::string UnicodeToUTF8(Unicode codepoint) {
+    std::string out;
+    if (codepoint <= 0x7f)
+        out.append(1, static_cast<char>(codepoint));
+    else if (codepoint <= 0x7ff) {
+        out.append(1, static_cast<char>(0xc0 | ((codepoint >> 6) & 0x1f)));
+        out.append(1, static_cast<char>(0x80 | (codepoint & 0x3f)));
+    } else if (codepoint <= 0xffff) {
+        out.append(1, static_cast<char>(0xe0 | ((codepoint >> 12) & 0x0f)));
+        out.append(1, static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
+        out.append(1, static_cast<char>(0x80 | (codepoint & 0x3f)));
+    } else {
+        out.append(1, static_cast<char>(0xf0 | ((codepoint >> 18) & 0x07)));
+        out.append(1, static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f)));
+        out.append(1, static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
+        out.append(1, static_cast<char>(0x80 | (codepoint & 0x3f)));
+    }
+    return out;
+}
 
 nlohmann::json add_json_node(DocumentNode& current_node);
 
 nlohmann::json add_json_node_list(DocumentNode& current_node);
 
+// same as add_json_node_list but serialize section by section to output, whole json array is never kept in memory
+void write_json_node_list(DocumentNode& current_node, std::ostream& output);
+
 // extract text block information from text block
 TextBlockInformation* extract_text_block_information(TextBlock* text_block, bool analyze_page_number, double y0, unsigned int title_max_length);
 
+TextBlockInformation* extract_text_block_information(GlyphBlock* text_block, bool analyze_page_number, double y0, unsigned int title_max_length);
+
 PDFDoc* open_pdf_document(char *file_name, char *owner_password, char *user_password);
 
+// open pdf read into memory, poppler reads buffer in place, buffer must outlive the document
+PDFDoc* open_pdf_document(std::vector<char>& buffer, char *owner_password, char *user_password);
+
 inline void print_all_fonts(PDFDoc* doc);
 
+// hash of page dict, contents and resources xref entries, changes when incremental update rewrites any of them
+uint64_t page_object_fingerprint(PDFDoc* doc, int page);
+
+// state.backend is set by caller, state saved by another backend isn't loaded,
+// nor state of another document or of a revision that isn't doc or the one it incrementally updates
+bool load_parse_state(const std::string& file_name, PDFDoc* doc, ParseState& state);
+
+bool save_parse_state(const std::string& file_name, const ParseState& state);
+
+bool load_pdf_shard(const std::string& file_name, PDFShard& shard);
+
+// stitch shards covering all pages of a document, output is the same as parse_pdf_document of whole document
+bool merge_pdf_shards(const std::vector<std::string>& shard_file_names, std::ostream& output);
+
 std::string parse_pdf_document(PDFDoc* doc);
+
+// write json to output while serializing, return false if document can't be parsed
+bool parse_pdf_document(PDFDoc* doc, std::ostream& output, const ParseOptions& options = ParseOptions());
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#ifndef TRACE_EVENTS_PER_THREAD
+#define TRACE_EVENTS_PER_THREAD 65536  // ring buffer size of each thread, oldest events are overwritten when full
+#endif
+
+#ifndef TRACE_EVENT_MAX_ARGS
+#define TRACE_EVENT_MAX_ARGS 3
+#endif
+
+extern std::atomic<bool> trace_events_recording;
+
+// start recording, timestamps are relative to this call
+void trace_events_enable();
+
+inline bool trace_events_enabled() {
+    return trace_events_recording.load(std::memory_order_relaxed);
+}
+
+// name of current thread in trace viewer, name must outlive the trace
+void trace_set_thread_name(const char* name);
+
+// complete event of current thread from construction to destruction, names and arg keys must be string literals,
+// nothing is recorded if tracing isn't enabled
+class TraceSpan {
+    public:
+        explicit TraceSpan(const char* name) : name(name), active(trace_events_enabled()) {
+            if (active) {
+                start_ns = trace_now_ns();
+            }
+        }
+
+        ~TraceSpan() {
+            if (active) {
+                record();
+            }
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        // args after TRACE_EVENT_MAX_ARGS are dropped
+        void arg(const char* key, int64_t value) {
+            if (active && arg_count < TRACE_EVENT_MAX_ARGS) {
+                arg_keys[arg_count] = key;
+                arg_values[arg_count] = value;
+                ++arg_count;
+            }
+        }
+
+    private:
+        static uint64_t trace_now_ns();
+
+        void record();
+
+        const char* name;
+        bool active;
+        uint64_t start_ns = 0;
+        int arg_count = 0;
+        const char* arg_keys[TRACE_EVENT_MAX_ARGS];
+        int64_t arg_values[TRACE_EVENT_MAX_ARGS];
+};
+
+// Chrome trace event json (chrome://tracing, Perfetto) of all threads, must be called after other threads stopped recording
+bool write_trace_events(std::ostream& output);
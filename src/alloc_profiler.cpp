@@ -0,0 +1,218 @@
+#include "alloc_profiler.hpp"
+
+#ifdef PDF_READER_ALLOC_PROFILING
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+static const char* alloc_stage_names[] = {
+    "other",
+    "layout",
+    "extraction",
+    "section_assembly",
+    "tree_build",
+    "serialization"
+};
+
+static const size_t STAGE_COUNT = static_cast<size_t>(AllocStage::COUNT);
+
+struct StageAllocCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<int64_t> live_bytes{0};
+    std::atomic<int64_t> peak_live_bytes{0};
+};
+
+struct PageAllocRecord {
+    int page = 0;
+    uint64_t allocations[STAGE_COUNT] = {};
+    uint64_t bytes[STAGE_COUNT] = {};
+};
+
+// header in front of each block, keeps size and stage to update live bytes of the right stage on delete,
+// 16 bytes so that returned pointer keeps malloc's alignment
+struct alignas(16) AllocHeader {
+    size_t size;
+    uint32_t stage;
+};
+
+static StageAllocCounters stage_counters[STAGE_COUNT];
+static std::atomic<int64_t> total_live_bytes{0};
+static std::atomic<int64_t> total_peak_live_bytes{0};
+
+static std::mutex page_records_mutex;
+static std::vector<PageAllocRecord>* page_records = nullptr;
+
+// trivially initialized, safe to use inside operator new before any static constructor
+static thread_local AllocStage current_stage = AllocStage::OTHER;
+static thread_local PageAllocRecord current_page_record;
+static thread_local bool inside_profiler = false;
+
+static void update_peak(std::atomic<int64_t>& peak, int64_t value) {
+    int64_t current_peak = peak.load(std::memory_order_relaxed);
+    while (value > current_peak && !peak.compare_exchange_weak(current_peak, value, std::memory_order_relaxed)) {
+    }
+}
+
+static void* profiled_allocate(size_t size) {
+    AllocHeader* header = static_cast<AllocHeader*>(std::malloc(sizeof(AllocHeader) + size));
+    if (!header) {
+        return nullptr;
+    }
+
+    // allocations of profiler itself are marked with STAGE_COUNT and not counted
+    size_t stage = inside_profiler ? STAGE_COUNT : static_cast<size_t>(current_stage);
+    header->size = size;
+    header->stage = static_cast<uint32_t>(stage);
+
+    if (!inside_profiler) {
+        StageAllocCounters& counters = stage_counters[stage];
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(size, std::memory_order_relaxed);
+        update_peak(counters.peak_live_bytes, counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+        update_peak(total_peak_live_bytes, total_live_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+
+        if (current_page_record.page > 0) {
+            ++current_page_record.allocations[stage];
+            current_page_record.bytes[stage] += size;
+        }
+    }
+
+    return header + 1;
+}
+
+static void profiled_free(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+
+    AllocHeader* header = static_cast<AllocHeader*>(pointer) - 1;
+    if (header->stage < STAGE_COUNT) {
+        stage_counters[header->stage].live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+        total_live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+    }
+    std::free(header);
+}
+
+static void* profiled_new(size_t size) {
+    void* pointer = profiled_allocate(size == 0 ? 1 : size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new(size_t size) {
+    return profiled_new(size);
+}
+
+void* operator new[](size_t size) {
+    return profiled_new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return profiled_allocate(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return profiled_allocate(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept {
+    profiled_free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    profiled_free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    profiled_free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    profiled_free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    profiled_free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    profiled_free(pointer);
+}
+
+AllocStageScope::AllocStageScope(AllocStage stage) : previous_stage(current_stage) {
+    current_stage = stage;
+}
+
+AllocStageScope::~AllocStageScope() {
+    current_stage = previous_stage;
+}
+
+// move counters of current page of this thread to page records
+static void flush_current_page_record() {
+    if (current_page_record.page > 0) {
+        inside_profiler = true;
+        {
+            std::lock_guard<std::mutex> lock(page_records_mutex);
+            if (!page_records) {
+                page_records = new std::vector<PageAllocRecord>();
+            }
+            page_records->push_back(current_page_record);
+        }
+        inside_profiler = false;
+    }
+    current_page_record = PageAllocRecord();
+}
+
+void alloc_profiler_set_page(int page) {
+    if (page != current_page_record.page) {
+        flush_current_page_record();
+        current_page_record.page = page;
+    }
+}
+
+bool write_alloc_report(std::ostream& output) {
+    flush_current_page_record();
+
+    inside_profiler = true;
+    nlohmann::json json_report;
+    for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        nlohmann::json& json_stage = json_report["stages"][alloc_stage_names[stage]];
+        json_stage["allocations"] = stage_counters[stage].allocations.load();
+        json_stage["bytes"] = stage_counters[stage].bytes.load();
+        json_stage["peak_live_bytes"] = stage_counters[stage].peak_live_bytes.load();
+    }
+    json_report["peak_live_bytes"] = total_peak_live_bytes.load();
+
+    json_report["pages"] = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(page_records_mutex);
+        if (page_records) {
+            for (const PageAllocRecord& page_record : *page_records) {
+                nlohmann::json json_page;
+                json_page["page"] = page_record.page;
+                for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+                    if (page_record.allocations[stage] > 0) {
+                        json_page[alloc_stage_names[stage]]["allocations"] = page_record.allocations[stage];
+                        json_page[alloc_stage_names[stage]]["bytes"] = page_record.bytes[stage];
+                    }
+                }
+                json_report["pages"].push_back(std::move(json_page));
+            }
+        }
+    }
+
+    output << json_report.dump(2) << std::endl;
+    inside_profiler = false;
+    return output.good();
+}
+
+#endif
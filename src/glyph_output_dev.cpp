@@ -0,0 +1,215 @@
+#include "glyph_output_dev.hpp"
+#include "pdf_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+const Unicode* GlyphWord::getChar(int i) const {
+    return &page->unicode[first_glyph + i];
+}
+
+GlyphFontInfo* GlyphWord::getFontInfo(int i) const {
+    return &page->fonts[page->font[first_glyph + i]];
+}
+
+void GlyphWord::getCharBBox(int i, double* xMin, double* yMin, double* xMax, double* yMax) const {
+    *xMin = page->x_min[first_glyph + i];
+    *yMin = page->y_min[first_glyph + i];
+    *xMax = page->x_max[first_glyph + i];
+    *yMax = page->y_max[first_glyph + i];
+}
+
+GooString* GlyphWord::getText() const {
+    std::string text;
+    for (uint32_t i = first_glyph; i < first_glyph + glyph_count; ++i) {
+        text += UnicodeToUTF8(page->unicode[i]);
+    }
+    return new GooString(text.c_str(), static_cast<int>(text.length()));
+}
+
+GlyphWord* GlyphLine::getWords() {
+    return &page->words[first_word];
+}
+
+GlyphLine* GlyphBlock::getLines() {
+    return &page->lines[first_line];
+}
+
+void GlyphPage::clear() {
+    x_min.clear();
+    y_min.clear();
+    x_max.clear();
+    y_max.clear();
+    base.clear();
+    font_size.clear();
+    unicode.clear();
+    font.clear();
+    space_before.clear();
+
+    for (GlyphFontInfo& font_info : fonts) {
+        font_info.gfxFont->decRefCnt();
+    }
+    fonts.clear();
+    words.clear();
+    lines.clear();
+    blocks.clear();
+}
+
+GlyphCollectorOutputDev::GlyphCollectorOutputDev() {
+}
+
+GlyphCollectorOutputDev::~GlyphCollectorOutputDev() {
+    page.clear();
+}
+
+// vectors keep their capacity, pages after the first one are collected without reallocation in most documents
+void GlyphCollectorOutputDev::startPage(int pageNum, GfxState* state, XRef* xref) {
+    page.clear();
+    current_font = nullptr;
+    pending_space = false;
+}
+
+void GlyphCollectorOutputDev::endPage() {
+    group_glyphs();
+}
+
+uint32_t GlyphCollectorOutputDev::font_index(GfxFont* gfx_font) {
+    for (uint32_t i = 0; i < page.fonts.size(); ++i) {
+        if (page.fonts[i].gfxFont == gfx_font) {
+            return i;
+        }
+    }
+
+    // fonts of page resources are released after display, keep them alive until page is cleared
+    gfx_font->incRefCnt();
+    page.fonts.push_back(GlyphFontInfo{gfx_font});
+    return static_cast<uint32_t>(page.fonts.size() - 1);
+}
+
+void GlyphCollectorOutputDev::drawChar(GfxState* state, double x, double y, double dx, double dy, double originX, double originY,
+                                       CharCode code, int nBytes, Unicode* u, int uLen) {
+    GfxFont* gfx_font = state->getFont();
+    if (!gfx_font || uLen == 0) {
+        return;
+    }
+
+    // spaces aren't kept, they only break words
+    if (uLen == 1 && (u[0] == 0x20 || u[0] == 0xa0)) {
+        pending_space = true;
+        return;
+    }
+
+    if (gfx_font != current_font) {
+        current_font = gfx_font;
+        current_font_index = font_index(gfx_font);
+    }
+
+    double x1, y1, w1, h1;
+    state->transform(x - originX, y - originY, &x1, &y1);
+    state->transformDelta(dx, dy, &w1, &h1);
+    double size = state->getTransformedFontSize();
+    double top = y1 - gfx_font->getAscent() * size;
+    double bottom = y1 - gfx_font->getDescent() * size;
+    if (bottom <= top) {
+        bottom = top + 1;
+    }
+    if (w1 < 0) {
+        x1 += w1;
+        w1 = -w1;
+    }
+
+    // ligatures map to several characters, their width is split evenly
+    double width = w1 / uLen;
+    for (int i = 0; i < uLen; ++i) {
+        page.x_min.push_back(x1 + i * width);
+        page.x_max.push_back(x1 + (i + 1) * width);
+        page.y_min.push_back(top);
+        page.y_max.push_back(bottom);
+        page.base.push_back(y1);
+        page.font_size.push_back(size);
+        page.unicode.push_back(u[i]);
+        page.font.push_back(current_font_index);
+        page.space_before.push_back(pending_space && i == 0);
+    }
+    pending_space = false;
+}
+
+// glyphs are grouped in the order they are drawn: a baseline change or a jump backward starts a line,
+// a line far below, above, in another column or in another font size starts a block
+void GlyphCollectorOutputDev::group_glyphs() {
+    size_t glyph_count = page.unicode.size();
+    for (size_t i = 0; i < glyph_count; ++i) {
+        double size = page.font_size[i];
+        bool new_block = page.blocks.empty();
+        bool new_line = new_block;
+        if (!new_block) {
+            GlyphLine& line = page.lines.back();
+            GlyphBlock& block = page.blocks.back();
+            new_line = std::fabs(page.base[i] - line.base) > GLYPH_LINE_BASELINE_DELTA * line.font_size ||
+                       page.x_min[i] < page.x_max[i - 1] - line.font_size;
+            new_block = new_line &&
+                        (page.base[i] < line.base ||
+                         page.base[i] - line.base > GLYPH_BLOCK_LINE_SPACING * line.font_size ||
+                         std::fabs(size - line.font_size) > GLYPH_BLOCK_FONT_SIZE_DELTA * line.font_size ||
+                         page.x_min[i] > block.xMax || page.x_max[i] < block.xMin);
+        }
+
+        if (new_block) {
+            GlyphBlock block;
+            block.page = &page;
+            block.first_line = static_cast<uint32_t>(page.lines.size());
+            block.line_count = 0;
+            block.xMin = page.x_min[i];
+            block.yMin = page.y_min[i];
+            block.xMax = page.x_max[i];
+            block.yMax = page.y_max[i];
+            block.last = false;
+            page.blocks.push_back(block);
+        }
+
+        if (new_line) {
+            GlyphLine line;
+            line.page = &page;
+            line.first_word = static_cast<uint32_t>(page.words.size());
+            line.base = page.base[i];
+            line.font_size = size;
+            line.xMin = page.x_min[i];
+            line.xMax = page.x_max[i];
+            line.last = false;
+            page.lines.push_back(line);
+            ++page.blocks.back().line_count;
+        }
+
+        if (new_line || page.space_before[i] || page.x_min[i] - page.x_max[i - 1] > GLYPH_WORD_BREAK_SPACE * size) {
+            GlyphWord word;
+            word.page = &page;
+            word.first_glyph = static_cast<uint32_t>(i);
+            word.glyph_count = 0;
+            word.last = false;
+            page.words.push_back(word);
+        }
+        ++page.words.back().glyph_count;
+
+        GlyphLine& line = page.lines.back();
+        line.xMin = std::min(line.xMin, page.x_min[i]);
+        line.xMax = std::max(line.xMax, page.x_max[i]);
+        GlyphBlock& block = page.blocks.back();
+        block.xMin = std::min(block.xMin, page.x_min[i]);
+        block.yMin = std::min(block.yMin, page.y_min[i]);
+        block.xMax = std::max(block.xMax, page.x_max[i]);
+        block.yMax = std::max(block.yMax, page.y_max[i]);
+    }
+
+    // last word of each line and last line of each block end their lists
+    for (size_t l = 0; l < page.lines.size(); ++l) {
+        size_t next_first_word = l + 1 < page.lines.size() ? page.lines[l + 1].first_word : page.words.size();
+        page.words[next_first_word - 1].last = true;
+    }
+    for (GlyphBlock& block : page.blocks) {
+        page.lines[block.first_line + block.line_count - 1].last = true;
+    }
+    if (!page.blocks.empty()) {
+        page.blocks.back().last = true;
+    }
+}
@@ -7,29 +7,343 @@
  * gfx: Graphic
  * To extract page in body of pages, specify -L,  flag
  * To set title max length, specify -L flag
+ * To compress output while writing, specify -z none|gzip|zstd flag, output is file.pdf.json.gz or file.pdf.json.zst
+ * To set compression level, specify -l flag, default is codec's default level
+ * To reparse new revision of incrementally updated pdf, specify --previous-state flag with state saved by --save-state flag,
+ * only pages whose objects changed are extracted again
+ * To build sections from document outline (bookmarks), specify --outline flag, heuristics are used if outline is missing or incomplete,
+ * it can't be combined with --previous-state or --save-state, state is only kept by heuristic section assembly
+ * To parse a page range only, specify --first-page and/or --last-page flag, partial result is written to file.pdf.<first>-<last>.shard.json,
+ * it can't be combined with -z, --outline, --previous-state or --save-state
+ * To stitch partial results, run: pdf_reader merge output.json shard.json...
+ * To write allocation counts per stage and page, specify --alloc-report flag, needs build with -DALLOC_PROFILING=ON
+ * To write Chrome trace event timeline (chrome://tracing, Perfetto) of the run, specify --trace=trace.json flag
+ * To collect text with lightweight glyph collector instead of TextOutputDev, specify --backend glyph flag,
+ * blocks are then in content stream order instead of reading order
+ * To read pdf from standard input, specify - as file, input is read into memory, output is written to standard output
+ * To set output file, specify -o flag, - is standard output
  */
 
+#include <cerrno>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <iostream>
 #include "pdf_utils.hpp"
+#include "output_compression.hpp"
+#include "alloc_profiler.hpp"
+#include "trace_events.hpp"
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void print_usage(const char* program_name) {
+    std::cerr << "Usage: " << program_name << " [-z none|gzip|zstd] [-l level] [--previous-state state.json] [--save-state state.json] [--outline]"
+              << " [--first-page n] [--last-page n] [--alloc-report report.json] [--trace=trace.json] [--backend text|glyph] [-o output.json|-] file.pdf|-" << std::endl;
+    std::cerr << "       " << program_name << " merge [-z none|gzip|zstd] [-l level] [--trace=trace.json] output.json|- shard.json..." << std::endl;
+}
+
+static bool write_trace_file(const char* trace_path) {
+    std::ofstream trace_file(trace_path);
+    if (!write_trace_events(trace_file)) {
+        std::cerr << "Failed to write " << trace_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool write_alloc_report_file(const char* alloc_report_path) {
+    std::ofstream alloc_report_file(alloc_report_path);
+    if (!write_alloc_report(alloc_report_file)) {
+        std::cerr << "Failed to write " << alloc_report_path << ", allocation profiling needs build with -DALLOC_PROFILING=ON" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// read whole standard input into buffer, buffer grows by doubling unless input is a file whose size is known
+static bool read_standard_input(std::vector<char>& buffer) {
+    struct stat input_stat;
+    size_t capacity = 1 << 20;
+    if (fstat(STDIN_FILENO, &input_stat) == 0 && S_ISREG(input_stat.st_mode) && input_stat.st_size > 0) {
+        // 1 more byte so end of input is read without growing
+        capacity = static_cast<size_t>(input_stat.st_size) + 1;
+    }
+    buffer.resize(capacity);
+
+    size_t length = 0;
+    while (true) {
+        if (length == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t read_length = read(STDIN_FILENO, buffer.data() + length, buffer.size() - length);
+        if (read_length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (read_length == 0) {
+            break;
+        }
+        length += static_cast<size_t>(read_length);
+    }
+    buffer.resize(length);
+    return length > 0;
+}
+
+// write to output file or standard output if name is -, through compression thread if compression is set
+static bool write_output(const std::string& output_file_name, CompressionType compression_type, std::optional<int> compression_level,
+                         const std::function<void(std::ostream&)>& write) {
+    std::ofstream output_file;
+    if (output_file_name != "-") {
+        output_file.open(output_file_name, std::ios::binary);
+        if (!output_file.is_open()) {
+            std::cerr << "Failed to open " << output_file_name << std::endl;
+            return false;
+        }
+    }
+    std::ostream& output_stream = output_file_name == "-" ? std::cout : output_file;
+
+    if (compression_type == CompressionType::NONE) {
+        write(output_stream);
+    } else {
+        std::unique_ptr<OutputCompressor> compressor = create_output_compressor(compression_type, compression_level);
+        if (!compressor) {
+            std::cerr << "Compression is not available in this build" << std::endl;
+            return false;
+        }
+
+        // compression runs on its own thread while document is parsed and serialized
+        CompressedOutputBuffer compressed_buffer(output_stream, std::move(compressor));
+        std::ostream compressed_output(&compressed_buffer);
+        write(compressed_output);
+        if (!compressed_buffer.close()) {
+            std::cerr << "Failed to write " << output_file_name << std::endl;
+            return false;
+        }
+    }
+    output_stream.flush();
+    if (!output_stream.good()) {
+        std::cerr << "Failed to write " << output_file_name << std::endl;
+        return false;
+    }
+    if (output_file.is_open()) {
+        output_file.close();
+        if (output_file.fail()) {
+            std::cerr << "Failed to write " << output_file_name << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
 
 int main(int argc, char* argv[]) {
+    // output may be written to std::cout, stdio isn't used, so it's buffered by iostream only
+    std::ios_base::sync_with_stdio(false);
+
     PDFDoc* doc;
 
     char owner_password[33] = "\001";
     char user_password[33] = "\001";
-    char* file_path = argv[1];
+    char* file_path = nullptr;
+    CompressionType compression_type = CompressionType::NONE;
+    std::optional<int> compression_level;
+    const char* previous_state_path = nullptr;
+    const char* save_state_path = nullptr;
+    const char* alloc_report_path = nullptr;
+    const char* trace_path = nullptr;
+    const char* output_path = nullptr;
+    ParseOptions parse_options;
+    bool merge = argc > 1 && std::strcmp(argv[1], "merge") == 0;
+    std::vector<std::string> shard_paths;
 
     // parse args
-    if (argc > 1) {
-        doc = open_pdf_document(file_path, owner_password, user_password);
+    for (int i = merge ? 2 : 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-z") == 0 && i + 1 < argc) {
+            std::optional<CompressionType> type = parse_compression_type(argv[++i]);
+            if (!type) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            compression_type = type.value();
+        } else if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            compression_level = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--previous-state") == 0 && i + 1 < argc) {
+            previous_state_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+            save_state_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--outline") == 0) {
+            parse_options.use_outline = true;
+        } else if (std::strcmp(argv[i], "--first-page") == 0 && i + 1 < argc) {
+            parse_options.first_page = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--last-page") == 0 && i + 1 < argc) {
+            parse_options.last_page = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--alloc-report") == 0 && i + 1 < argc) {
+            alloc_report_path = argv[++i];
+        } else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+            trace_path = argv[i] + 8;
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "text") == 0) {
+                parse_options.backend = TextBackend::TEXT_OUTPUT_DEV;
+            } else if (std::strcmp(argv[i], "glyph") == 0) {
+                parse_options.backend = TextBackend::GLYPH_COLLECTOR;
+            } else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (!file_path) {
+            file_path = argv[i];
+        } else if (merge) {
+            shard_paths.push_back(argv[i]);
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // outline sections don't track extracted pages, saved state would be stale
+    if (parse_options.use_outline && (previous_state_path || save_state_path)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // shard is always assembled by heuristics and doesn't track extracted pages,
+    // it is an intermediate result, written uncompressed to be read by merge
+    bool page_range = parse_options.first_page > 0 || parse_options.last_page > 0;
+    if (page_range && (parse_options.use_outline || previous_state_path || save_state_path || compression_type != CompressionType::NONE)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (parse_options.first_page < 0 || parse_options.last_page < 0 ||
+        (parse_options.last_page > 0 && parse_options.first_page > parse_options.last_page)) {
+        std::cerr << "Invalid page range, pages start at 1 and first page must not be after last page" << std::endl;
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (trace_path) {
+        trace_events_enable();
+        trace_set_thread_name("main");
+    }
+
+    if (merge) {
+        // with -o, every positional argument is a shard
+        if (output_path && file_path) {
+            shard_paths.insert(shard_paths.begin(), file_path);
+            file_path = nullptr;
+        }
+        const char* merge_output_path = output_path ? output_path : file_path;
+        if (!merge_output_path || shard_paths.empty()) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        bool merged = false;
+        if (!write_output(merge_output_path, compression_type, compression_level, [&](std::ostream& output) {
+            TraceSpan trace_span("merge_shards");
+            trace_span.arg("shards", shard_paths.size());
+            merged = merge_pdf_shards(shard_paths, output);
+        })) {
+            return EXIT_FAILURE;
+        }
+        if (!merged) {
+            std::cerr << "Shards are invalid or don't cover all pages of the document" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (alloc_report_path && !write_alloc_report_file(alloc_report_path)) {
+            return EXIT_FAILURE;
+        }
+        if (trace_path && !write_trace_file(trace_path)) {
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // poppler reads input buffer in place, it is kept until the end
+    std::vector<char> input_buffer;
+    bool read_stdin = file_path && std::strcmp(file_path, "-") == 0;
+    if (read_stdin) {
+        TraceSpan trace_span("read_input");
+        if (!read_standard_input(input_buffer)) {
+            std::cerr << "Failed to read pdf from standard input" << std::endl;
+            return EXIT_FAILURE;
+        }
+        trace_span.arg("bytes", input_buffer.size());
+    }
+
+    if (file_path) {
+        TraceSpan trace_span("open_document");
+        if (read_stdin) {
+            doc = open_pdf_document(input_buffer, owner_password, user_password);
+        } else {
+            doc = open_pdf_document(file_path, owner_password, user_password);
+        }
+    } else {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (page_range && doc->isOk() && std::max(parse_options.first_page, 1) > doc->getNumPages()) {
+        std::cerr << "First page is after end of document, which has " << doc->getNumPages() << " pages" << std::endl;
+        delete doc;
+        return EXIT_FAILURE;
+    }
+
+    // state is kept only if it's saved or used by this run
+    ParseState parse_state;
+    parse_state.backend = parse_options.backend;
+    if (previous_state_path || save_state_path) {
+        parse_options.incremental_state = &parse_state;
+    }
+    if (previous_state_path && !load_parse_state(previous_state_path, doc, parse_state)) {
+        std::cerr << "Can't load " << previous_state_path << ", parse all pages" << std::endl;
+    }
+
+    bool write_shard = page_range;
+
+    // output is next to input file unless it is set, input from standard input goes to standard output
+    std::string output_file_name;
+    if (output_path) {
+        output_file_name = output_path;
+    } else if (read_stdin) {
+        output_file_name = "-";
+    } else if (write_shard) {
+        output_file_name = std::string(file_path) + "." + std::to_string(std::max(parse_options.first_page, 1)) + "-" +
+                           (parse_options.last_page > 0 ? std::to_string(parse_options.last_page) : std::string("end")) + ".shard.json";
     } else {
+        output_file_name = std::string(file_path) + ".json" + compression_file_extension(compression_type);
+    }
+
+    if (!write_output(output_file_name, compression_type, compression_level, [&](std::ostream& output) {
+        TraceSpan trace_span("parse_document");
+        parse_pdf_document(doc, output, parse_options);
+    })) {
+        return EXIT_FAILURE;
+    }
+
+    // pages not extracted again were reused from previous state
+    if (previous_state_path) {
+        std::cerr << "Extracted " << parse_state.extracted_pages << " of " << parse_state.pages.size() << " pages" << std::endl;
+    }
+
+    if (save_state_path && !save_parse_state(save_state_path, parse_state)) {
+        std::cerr << "Failed to write " << save_state_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (alloc_report_path && !write_alloc_report_file(alloc_report_path)) {
         return EXIT_FAILURE;
     }
 
-    std::string output_file_name(std::string(file_path) + ".json");
-    std::ofstream pdf_document_json_file(output_file_name);
-    pdf_document_json_file << std::move(parse_pdf_document(doc));
-    pdf_document_json_file.close();
+    if (trace_path && !write_trace_file(trace_path)) {
+        return EXIT_FAILURE;
+    }
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,227 @@
+#include "output_compression.hpp"
+#include "trace_events.hpp"
+#include <cstring>
+#include <zlib.h>
+#ifdef PDF_READER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+class GzipCompressor : public OutputCompressor {
+    public:
+        explicit GzipCompressor(int level) : out_buffer(OUTPUT_COMPRESSION_CHUNK_SIZE) {
+            std::memset(&stream, 0, sizeof(stream));
+            // 15 + 16: max window size, write gzip header and trailer instead of zlib's
+            ok = deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        }
+
+        ~GzipCompressor() {
+            if (ok) {
+                deflateEnd(&stream);
+            }
+        }
+
+        bool compress(const char* data, size_t length, bool finish, std::ostream& sink) override {
+            if (!ok) {
+                return false;
+            }
+
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            stream.avail_in = static_cast<uInt>(length);
+            int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+            int result;
+            do {
+                stream.next_out = reinterpret_cast<Bytef*>(out_buffer.data());
+                stream.avail_out = static_cast<uInt>(out_buffer.size());
+                result = deflate(&stream, flush);
+                if (result == Z_STREAM_ERROR) {
+                    return false;
+                }
+                sink.write(out_buffer.data(), out_buffer.size() - stream.avail_out);
+            } while (stream.avail_out == 0);
+
+            return sink.good() && (!finish || result == Z_STREAM_END);
+        }
+
+    private:
+        z_stream stream;
+        std::vector<char> out_buffer;
+        bool ok;
+};
+
+#ifdef PDF_READER_HAVE_ZSTD
+class ZstdCompressor : public OutputCompressor {
+    public:
+        explicit ZstdCompressor(int level) : out_buffer(ZSTD_CStreamOutSize()) {
+            context = ZSTD_createCCtx();
+            ok = context && !ZSTD_isError(ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, level));
+        }
+
+        ~ZstdCompressor() {
+            ZSTD_freeCCtx(context);
+        }
+
+        bool compress(const char* data, size_t length, bool finish, std::ostream& sink) override {
+            if (!ok) {
+                return false;
+            }
+
+            ZSTD_inBuffer input = {data, length, 0};
+            ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+            size_t remaining;
+            do {
+                ZSTD_outBuffer output = {out_buffer.data(), out_buffer.size(), 0};
+                remaining = ZSTD_compressStream2(context, &output, &input, mode);
+                if (ZSTD_isError(remaining)) {
+                    return false;
+                }
+                sink.write(out_buffer.data(), output.pos);
+                // ZSTD_e_end is done when nothing is left to flush, ZSTD_e_continue when input is consumed
+            } while (finish ? remaining != 0 : input.pos != input.size);
+
+            return sink.good();
+        }
+
+    private:
+        ZSTD_CCtx* context;
+        std::vector<char> out_buffer;
+        bool ok;
+};
+#endif
+
+CompressedOutputBuffer::CompressedOutputBuffer(std::ostream& sink, std::unique_ptr<OutputCompressor> compressor) :
+    sink(sink),
+    compressor(std::move(compressor)),
+    buffer(OUTPUT_COMPRESSION_CHUNK_SIZE) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+    worker = std::thread(&CompressedOutputBuffer::compression_worker, this);
+}
+
+CompressedOutputBuffer::~CompressedOutputBuffer() {
+    close();
+}
+
+bool CompressedOutputBuffer::close() {
+    if (!closed) {
+        closed = true;
+        submit_chunk(true);
+        worker.join();
+        sink.flush();
+    }
+    return !failed && sink.good();
+}
+
+CompressedOutputBuffer::int_type CompressedOutputBuffer::overflow(int_type ch) {
+    if (closed || failed) {
+        return traits_type::eof();
+    }
+
+    submit_chunk(false);
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int CompressedOutputBuffer::sync() {
+    // data is flushed to sink when compression stream ends, only hand buffered data to compression thread here
+    if (!closed && pptr() > pbase()) {
+        submit_chunk(false);
+    }
+    return failed ? -1 : 0;
+}
+
+void CompressedOutputBuffer::submit_chunk(bool finish) {
+    size_t length = pptr() - pbase();
+    Chunk chunk;
+    chunk.data = std::move(buffer);
+    chunk.data.resize(length);
+    chunk.finish = finish;
+
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    // bounded queue, parsing waits for compression instead of buffering whole document
+    {
+        TraceSpan trace_span("wait_compression");
+        trace_span.arg("pending_chunks", pending_chunks.size());
+        chunks_condition.wait(lock, [this] {
+            return pending_chunks.size() < OUTPUT_COMPRESSION_MAX_PENDING_CHUNKS;
+        });
+    }
+    pending_chunks.push_back(std::move(chunk));
+    if (!free_buffers.empty()) {
+        buffer = std::move(free_buffers.front());
+        free_buffers.pop_front();
+    } else {
+        buffer = std::vector<char>();
+    }
+    lock.unlock();
+    chunks_condition.notify_all();
+
+    buffer.resize(OUTPUT_COMPRESSION_CHUNK_SIZE);
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+void CompressedOutputBuffer::compression_worker() {
+    trace_set_thread_name("compression");
+    bool finish = false;
+    while (!finish) {
+        std::unique_lock<std::mutex> lock(chunks_mutex);
+        chunks_condition.wait(lock, [this] {
+            return !pending_chunks.empty();
+        });
+        Chunk chunk = std::move(pending_chunks.front());
+        pending_chunks.pop_front();
+        lock.unlock();
+        chunks_condition.notify_all();
+
+        finish = chunk.finish;
+        {
+            TraceSpan trace_span("compress_chunk");
+            trace_span.arg("bytes", chunk.data.size());
+            if (!failed && !compressor->compress(chunk.data.data(), chunk.data.size(), finish, sink)) {
+                failed = true;
+            }
+        }
+
+        // give the buffer back to the parsing thread
+        lock.lock();
+        free_buffers.push_back(std::move(chunk.data));
+    }
+}
+
+std::optional<CompressionType> parse_compression_type(const std::string& name) {
+    if (name == "none") {
+        return CompressionType::NONE;
+    } else if (name == "gzip" || name == "gz") {
+        return CompressionType::GZIP;
+    } else if (name == "zstd" || name == "zst") {
+        return CompressionType::ZSTD;
+    }
+    return std::nullopt;
+}
+
+std::unique_ptr<OutputCompressor> create_output_compressor(CompressionType type, std::optional<int> level) {
+    switch (type) {
+        case CompressionType::GZIP:
+            return std::make_unique<GzipCompressor>(level.value_or(Z_DEFAULT_COMPRESSION));
+        case CompressionType::ZSTD:
+#ifdef PDF_READER_HAVE_ZSTD
+            return std::make_unique<ZstdCompressor>(level.value_or(ZSTD_CLEVEL_DEFAULT));
+#else
+            return nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const char* compression_file_extension(CompressionType type) {
+    switch (type) {
+        case CompressionType::GZIP:
+            return ".gz";
+        case CompressionType::ZSTD:
+            return ".zst";
+        default:
+            return "";
+    }
+}
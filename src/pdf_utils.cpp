@@ -1,32 +1,18 @@
 #include "pdf_utils.hpp"
+#include "alloc_profiler.hpp"
+#include "trace_events.hpp"
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <unordered_set>
 #include <FontInfo.h>
 
 const double TitleFormat::INDENT_DELTA_THRESHOLD = TITLE_FORMAT_INDENT_DELTA;
 
-inline std::string UnicodeToUTF8(Unicode codepoint) {
-    std::string out;
-    if (codepoint <= 0x7f)
-        out.append(1, static_cast<char>(codepoint));
-    else if (codepoint <= 0x7ff) {
-        out.append(1, static_cast<char>(0xc0 | ((codepoint >> 6) & 0x1f)));
-        out.append(1, static_cast<char>(0x80 | (codepoint & 0x3f)));
-    } else if (codepoint <= 0xffff) {
-        out.append(1, static_cast<char>(0xe0 | ((codepoint >> 12) & 0x0f)));
-        out.append(1, static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
-        out.append(1, static_cast<char>(0x80 | (codepoint & 0x3f)));
-    } else {
-        out.append(1, static_cast<char>(0xf0 | ((codepoint >> 18) & 0x07)));
-        out.append(1, static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f)));
-        out.append(1, static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
-        out.append(1, static_cast<char>(0x80 | (codepoint & 0x3f)));
-    }
-    return out;
-}
-
 bool TitleFormat::operator ==(const TitleFormat& title_format) {
     return font_ref.num == title_format.font_ref.num &&
            title_case == title_format.title_case &&
@@ -55,48 +41,64 @@ bool TitleFormat::operator !=(const TitleFormat& title_format) {
 TitleFormat::TitleFormat() {
 }
 
-TitleFormat::TitleFormat(const TitleFormat& other) :
-    font_ref(other.font_ref),
-    title_case(other.title_case),
-    prefix(other.prefix),
-    emphasize_style(other.emphasize_style),
-    numbering_level(other.numbering_level),
-    same_line_with_content(other.same_line_with_content),
-    indent(other.indent) {
+SectionContent& SectionContent::operator=(std::string text) {
+    chunks.clear();
+    content_length = 0;
+    append(std::move(text));
+    return *this;
+}
 
+void SectionContent::append(std::string&& text) {
+    if (!text.empty()) {
+        content_length += text.length();
+        chunks.push_back(std::move(text));
+    }
+}
+
+void SectionContent::append(SectionContent&& other) {
+    chunks.insert(chunks.end(), std::make_move_iterator(other.chunks.begin()), std::make_move_iterator(other.chunks.end()));
+    content_length += other.content_length;
+    other.chunks.clear();
+    other.content_length = 0;
 }
 
-TitleFormat::TitleFormat(TitleFormat&& other) :
-    font_ref(other.font_ref),
-    title_case(other.title_case),
-    prefix(other.prefix),
-    emphasize_style(other.emphasize_style),
-    numbering_level(other.numbering_level),
-    same_line_with_content(other.same_line_with_content),
-    indent(other.indent) {
+void SectionContent::trim() {
+    // chunks that are whitespace only are dropped
+    std::vector<std::string>::iterator first = chunks.begin();
+    while (first != chunks.end()) {
+        ltrim(*first);
+        if (!first->empty()) {
+            break;
+        }
+        ++first;
+    }
+    chunks.erase(chunks.begin(), first);
 
+    while (!chunks.empty()) {
+        rtrim(chunks.back());
+        if (!chunks.back().empty()) {
+            break;
+        }
+        chunks.pop_back();
+    }
+
+    content_length = 0;
+    for (const std::string& chunk : chunks) {
+        content_length += chunk.length();
+    }
 }
 
-TitleFormat& TitleFormat::operator=(const TitleFormat& other) {
-    font_ref = other.font_ref;
-    title_case = other.title_case;
-    prefix = other.prefix;
-    emphasize_style = other.emphasize_style;
-    numbering_level = other.numbering_level;
-    same_line_with_content = other.same_line_with_content;
-    indent = other.indent;
-    return *this;
+size_t SectionContent::length() const {
+    return content_length;
 }
 
-TitleFormat& TitleFormat::operator=(TitleFormat&& other) {
-    font_ref = other.font_ref;
-    title_case = other.title_case;
-    prefix = other.prefix;
-    emphasize_style = other.emphasize_style;
-    numbering_level = other.numbering_level;
-    same_line_with_content = other.same_line_with_content;
-    indent = other.indent;
-    return *this;
+std::string SectionContent::str() const {
+    std::string content;
+    content.reserve(content_length);
+    for (const std::string& chunk : chunks) {
+        content += chunk;
+    }
+    return content;
 }
 
 std::ostream& operator<<(std::ostream& os, const TitleFormat& tf) {
@@ -110,12 +112,100 @@ std::ostream& operator<<(std::ostream& os, const TitleFormat& tf) {
     return os;
 }
 
+// same names as --backend flag
+static const char* text_backend_name(TextBackend backend) {
+    return backend == TextBackend::GLYPH_COLLECTOR ? "glyph" : "text";
+}
+
+static std::optional<TextBackend> parse_text_backend(const std::string& name) {
+    if (name == "text") {
+        return TextBackend::TEXT_OUTPUT_DEV;
+    } else if (name == "glyph") {
+        return TextBackend::GLYPH_COLLECTOR;
+    }
+    return std::nullopt;
+}
+
+static nlohmann::json title_format_to_json(const TitleFormat& title_format) {
+    nlohmann::json json_title_format;
+    json_title_format["font_ref"] = {title_format.font_ref.num, title_format.font_ref.gen};
+    json_title_format["title_case"] = static_cast<unsigned int>(title_format.title_case);
+    json_title_format["prefix"] = static_cast<unsigned int>(title_format.prefix);
+    json_title_format["emphasize_style"] = static_cast<unsigned int>(title_format.emphasize_style);
+    json_title_format["numbering_level"] = title_format.numbering_level;
+    json_title_format["same_line_with_content"] = title_format.same_line_with_content;
+    json_title_format["indent"] = title_format.indent;
+    return json_title_format;
+}
+
+static TitleFormat title_format_from_json(const nlohmann::json& json_title_format) {
+    TitleFormat title_format;
+    title_format.font_ref.num = json_title_format.at("font_ref")[0];
+    title_format.font_ref.gen = json_title_format.at("font_ref")[1];
+    title_format.title_case = static_cast<TitleFormat::CASE>(json_title_format.at("title_case").get<unsigned int>());
+    title_format.prefix = static_cast<TitleFormat::PREFIX>(json_title_format.at("prefix").get<unsigned int>());
+    title_format.emphasize_style = static_cast<TitleFormat::EMPHASIZE_STYLE>(json_title_format.at("emphasize_style").get<unsigned int>());
+    title_format.numbering_level = json_title_format.at("numbering_level");
+    title_format.same_line_with_content = json_title_format.at("same_line_with_content");
+    title_format.indent = json_title_format.at("indent");
+    return title_format;
+}
+
+static nlohmann::json text_block_to_json(const TextBlockInformation& text_block_information) {
+    nlohmann::json json_block;
+    json_block["is_page_number"] = text_block_information.is_page_number;
+    if (text_block_information.title_format) {
+        json_block["title_format"] = title_format_to_json(text_block_information.title_format.value());
+    }
+    json_block["keywords"] = text_block_information.emphasized_words;
+    json_block["content"] = text_block_information.partial_paragraph_content;
+    return json_block;
+}
+
+static TextBlockInformation text_block_from_json(const nlohmann::json& json_block) {
+    TextBlockInformation text_block_information;
+    text_block_information.is_page_number = json_block.at("is_page_number");
+    if (json_block.contains("title_format")) {
+        text_block_information.title_format = title_format_from_json(json_block.at("title_format"));
+    }
+    for (const nlohmann::json& emphasized_word : json_block.at("keywords")) {
+        text_block_information.emphasized_words.push_back(emphasized_word);
+    }
+    text_block_information.partial_paragraph_content = json_block.at("content");
+    return text_block_information;
+}
+
+// title format is only set when section has a title
+static nlohmann::json section_to_json(const PDFSection& pdf_section) {
+    nlohmann::json json_section;
+    json_section["title"] = pdf_section.title;
+    if (pdf_section.title.length() > 0) {
+        json_section["title_format"] = title_format_to_json(pdf_section.title_format);
+    }
+    json_section["keywords"] = pdf_section.emphasized_words;
+    json_section["content"] = pdf_section.content.str();
+    return json_section;
+}
+
+static PDFSection section_from_json(const nlohmann::json& json_section) {
+    PDFSection pdf_section;
+    pdf_section.title = json_section.at("title");
+    if (json_section.contains("title_format")) {
+        pdf_section.title_format = title_format_from_json(json_section.at("title_format"));
+    }
+    for (const nlohmann::json& emphasized_word : json_section.at("keywords")) {
+        pdf_section.emphasized_words.push_back(emphasized_word);
+    }
+    pdf_section.content = json_section.at("content").get<std::string>();
+    return pdf_section;
+}
+
 // recursive
 nlohmann::json add_json_node(DocumentNode& current_node) {
     nlohmann::json json_pdf_section;
     json_pdf_section["id"] = current_node.main_section->id;
     json_pdf_section["title"] = current_node.main_section->title;
-    json_pdf_section["content"] = current_node.main_section->content;
+    json_pdf_section["content"] = current_node.main_section->content.str();
     json_pdf_section["parent_id"] = current_node.parent_node->main_section->id;
     for (std::string emphasized_word : current_node.main_section->emphasized_words) {
         json_pdf_section["keywords"] += emphasized_word;
@@ -130,6 +220,21 @@ nlohmann::json add_json_node(DocumentNode& current_node) {
     return json_pdf_section;
 }
 
+// json object of 1 section in list presentation, id is assigned in traversal order
+static nlohmann::json make_json_list_section(DocumentNode* current_node, unsigned int id) {
+    nlohmann::json json_pdf_section;
+    current_node->main_section->id = id;
+    json_pdf_section["id"] = current_node->main_section->id;
+    json_pdf_section["title"] = current_node->main_section->title;
+    json_pdf_section["content"] = current_node->main_section->content.str();
+    for (std::string emphasized_word : current_node->main_section->emphasized_words) {
+        json_pdf_section["keywords"] += emphasized_word;
+    }
+    if (current_node->parent_node)
+        json_pdf_section["parent_id"] = current_node->parent_node->main_section->id;
+    return json_pdf_section;
+}
+
 nlohmann::json add_json_node_list(DocumentNode& current_node) {
     nlohmann::json json_node_list;
     std::list<DocumentNode*> doc_node_stack;
@@ -140,18 +245,8 @@ nlohmann::json add_json_node_list(DocumentNode& current_node) {
         DocumentNode *current_node = doc_node_stack.back();
         doc_node_stack.pop_back();
 
-        nlohmann::json json_pdf_section;
-        current_node->main_section->id = id++;
-        json_pdf_section["id"] = current_node->main_section->id;
-        json_pdf_section["title"] = current_node->main_section->title;
-        json_pdf_section["content"] = current_node->main_section->content;
-        for (std::string emphasized_word : current_node->main_section->emphasized_words) {
-            json_pdf_section["keywords"] += emphasized_word;
-        }
-        if (current_node->parent_node)
-            json_pdf_section["parent_id"] = current_node->parent_node->main_section->id;
         // process
-        json_node_list.push_back(json_pdf_section);
+        json_node_list.push_back(make_json_list_section(current_node, id++));
 
         if (current_node->sub_sections) {
             for (DocumentNode& node : current_node->sub_sections.value()) {
@@ -162,8 +257,50 @@ nlohmann::json add_json_node_list(DocumentNode& current_node) {
     return json_node_list;
 }
 
-// extract text block information from text block
-TextBlockInformation* extract_text_block_information(TextBlock* text_block, bool analyze_page_number, double y0, unsigned int title_max_length)  {
+void write_json_node_list(DocumentNode& current_node, std::ostream& output) {
+    AllocStageScope alloc_stage_scope(AllocStage::SERIALIZATION);
+    TraceSpan trace_span("serialize");
+    std::list<DocumentNode*> doc_node_stack;
+    doc_node_stack.push_back(&current_node);
+    unsigned int id = 0;
+    output << '[';
+    while (!doc_node_stack.empty()) {
+        // take 1 element
+        DocumentNode *current_node = doc_node_stack.back();
+        doc_node_stack.pop_back();
+
+        // process, same output as add_json_node_list(...).dump()
+        if (id > 0) {
+            output << ',';
+        }
+        output << make_json_list_section(current_node, id++);
+
+        if (current_node->sub_sections) {
+            for (DocumentNode& node : current_node->sub_sections.value()) {
+                doc_node_stack.push_back(&node);
+            }
+        }
+    }
+    output << ']';
+}
+
+// UTF-8 character i of a TextWord or GlyphWord, every path that reads block text converts characters here
+template <typename Word>
+static std::string block_character(Word* word, int i) {
+    std::string character = UnicodeToUTF8(*(word->getChar(i)));
+
+    // TODO: linhlt: temporary fix
+    if (character.compare("“") == 0 || character.compare("”") == 0) {
+        character = "\"";
+    }
+    return character;
+}
+
+// extract text block information from text block, Block is TextBlock or GlyphBlock which have the same accessors,
+// characters of content are added to glyphs if it is set
+template <typename Block>
+static TextBlockInformation* extract_block_information(Block* text_block, bool analyze_page_number, double y0, unsigned int title_max_length,
+                                                       int64_t* glyphs = nullptr)  {
     TextBlockInformation* text_block_information = new TextBlockInformation;
 
     // check if text block is page number
@@ -176,9 +313,9 @@ TextBlockInformation* extract_text_block_information(TextBlock* text_block, bool
     std::smatch page_number_regex_match;
     if (analyze_page_number && yMinA >= y0) {
         if (text_block->getLineCount() == 1) {  // page number is in 1 line only
-            TextLine* line = text_block->getLines();
+            auto* line = text_block->getLines();
             std::string line_string;
-            for (TextWord* word = line->getWords(); word; word = word->getNext()) {
+            for (auto* word = line->getWords(); word; word = word->getNext()) {
                 GooString* text_word = word->getText();
                 line_string += text_word->toStr() + " ";
                 delete text_word;
@@ -192,19 +329,17 @@ TextBlockInformation* extract_text_block_information(TextBlock* text_block, bool
         std::stringstream partial_paragraph_content_string_stream;
         std::stringstream emphasized_word_string_stream;
         bool parsing_emphasized_word = false;
-        TextFontInfo* font_info, *prev_font_info = nullptr;
+        decltype(text_block->getLines()->getWords()->getFontInfo(0)) font_info, prev_font_info = nullptr;
         std::optional<std::string> title_prefix;
-        for (TextLine* line = text_block->getLines(); line; line = line->getNext()) {
-            for (TextWord* word = line->getWords(); word; word = word->getNext()) {
+        for (auto* line = text_block->getLines(); line; line = line->getNext()) {
+            for (auto* word = line->getWords(); word; word = word->getNext()) {
                 // extract a partition of emphasized word from word
                 int word_length = word->getLength();
+                if (glyphs) {
+                    *glyphs += word_length;
+                }
                 for (int i = 0; i < word_length; ++i) {
-                    std::string character = UnicodeToUTF8(*(word->getChar(i)));
-
-                    // TODO: linhlt: temporary fix
-                    if (character.compare("“") == 0 || character.compare("”") == 0) {
-                        character = "\"";
-                    }
+                    std::string character = block_character(word, i);
 
                     font_info = word->getFontInfo(i);
                     if (parsing_emphasized_word && prev_font_info) {  // just need to compare to font of previous character
@@ -454,192 +589,680 @@ TextBlockInformation* extract_text_block_information(TextBlock* text_block, bool
     return text_block_information;
 }
 
+TextBlockInformation* extract_text_block_information(TextBlock* text_block, bool analyze_page_number, double y0, unsigned int title_max_length) {
+    return extract_block_information(text_block, analyze_page_number, y0, title_max_length);
+}
+
+TextBlockInformation* extract_text_block_information(GlyphBlock* text_block, bool analyze_page_number, double y0, unsigned int title_max_length) {
+    return extract_block_information(text_block, analyze_page_number, y0, title_max_length);
+}
+
+// password is unset if it starts with \001, caller deletes returned string
+static GooString* make_password(char* password) {
+    if (password[0] != '\001') {
+        return new GooString(password);
+    }
+    return nullptr;
+}
+
 PDFDoc* open_pdf_document(char* file_name, char* owner_password, char* user_password) {
     GooString* fileName;
-    GooString* ownerPW, *userPW;
+    GooString* ownerPW = make_password(owner_password);
+    GooString* userPW = make_password(user_password);
 
     // parse filename, filename is non null pointer
     fileName = new GooString(file_name);
 
-    // owner password
-    if (owner_password[0] != '\001') {
-        ownerPW = new GooString(owner_password);
-    } else {
-        ownerPW = nullptr;
+    PDFDoc* doc = PDFDocFactory().createPDFDoc(*fileName, ownerPW, userPW);
+
+    delete fileName;
+    delete userPW;
+    delete ownerPW;
+
+    return doc;
+}
+
+PDFDoc* open_pdf_document(std::vector<char>& buffer, char* owner_password, char* user_password) {
+    GooString* ownerPW = make_password(owner_password);
+    GooString* userPW = make_password(user_password);
+
+    // document owns the stream, stream doesn't own the buffer
+    MemStream* stream = new MemStream(buffer.data(), 0, buffer.size(), Object(objNull));
+    PDFDoc* doc = new PDFDoc(stream, ownerPW, userPW);
+
+    delete userPW;
+    delete ownerPW;
+
+    return doc;
+}
+
+std::string parse_pdf_document(PDFDoc *doc) {
+    std::ostringstream output;
+    parse_pdf_document(doc, output);
+    return output.str();
+}
+
+// display 1 page with output device of the backend, call process_block with each TextBlock* or GlyphBlock* of the page
+// and glyph count of trace span, process_block adds characters it reads to the count, blocks expire after this returns,
+// blocks that process_block skips, like footers, add no glyphs, both backends count the same glyphs
+template <typename ProcessBlock>
+static void for_each_text_block(PDFDoc* doc, OutputDev* output_dev, TextBackend backend, int page, double resolution,
+                                ProcessBlock process_block) {
+    if (backend == TextBackend::GLYPH_COLLECTOR) {
+        GlyphCollectorOutputDev* glyph_out = static_cast<GlyphCollectorOutputDev*>(output_dev);
+        {
+            AllocStageScope alloc_stage_scope(AllocStage::LAYOUT);
+            TraceSpan trace_span("display_page");
+            trace_span.arg("page", page);
+            doc->displayPage(glyph_out, page, resolution, resolution, 0, gTrue, gFalse, gFalse);
+        }
+
+        AllocStageScope alloc_stage_scope(AllocStage::EXTRACTION);
+        TraceSpan trace_span("extract_blocks");
+        int64_t glyphs = 0;
+        for (GlyphBlock* text_block = glyph_out->getPage().getBlocks(); text_block; text_block = text_block->getNext()) {
+            process_block(text_block, glyphs);
+        }
+        trace_span.arg("page", page);
+        trace_span.arg("blocks", glyph_out->getPage().blocks.size());
+        trace_span.arg("glyphs", glyphs);
+        return;
     }
 
-    // user password
-    if (user_password[0] != '\001') {
-        userPW = new GooString(user_password);
-    } else {
-        userPW = nullptr;
+    TextOutputDev* textOut = static_cast<TextOutputDev*>(output_dev);
+    TextPage* textPage;
+    {
+        AllocStageScope alloc_stage_scope(AllocStage::LAYOUT);
+        TraceSpan trace_span("display_page");
+        trace_span.arg("page", page);
+        doc->displayPage(textOut, page, resolution, resolution, 0, gTrue, gFalse, gFalse);
+        textPage = textOut->takeText();
     }
 
-    PDFDoc* doc = PDFDocFactory().createPDFDoc(*fileName, ownerPW, userPW);
+    AllocStageScope alloc_stage_scope(AllocStage::EXTRACTION);
+    TraceSpan trace_span("extract_blocks");
+    int64_t blocks = 0, glyphs = 0;
+    for (TextFlow* flow = textPage->getFlows(); flow; flow = flow->getNext()) {
+        for (TextBlock* text_block = flow->getBlocks(); text_block; text_block = text_block->getNext()) {
+            ++blocks;
+            process_block(text_block, glyphs);
+        }
+    }
+    textPage->decRefCnt();
+    trace_span.arg("page", page);
+    trace_span.arg("blocks", blocks);
+    trace_span.arg("glyphs", glyphs);
+}
 
-    delete fileName;
+// extract text blocks of 1 page, must be done while text page is alive
+static void extract_page_text_blocks(PDFDoc* doc, OutputDev* output_dev, TextBackend backend, int page, double resolution,
+                                     int page_footer_height, unsigned int title_max_length, PageExtraction& page_extraction) {
+    alloc_profiler_set_page(page);
+    PDFRectangle* page_mediabox =  doc->getPage(page)->getMediaBox();
+    double y0 = page_mediabox->y2 - page_footer_height;
+    bool start_parse = page_extraction.start_parse;
+
+    for_each_text_block(doc, output_dev, backend, page, resolution, [&](auto* text_block, int64_t& glyphs) {
+        // must process text_block here as it'll expire after parsing page
+        TextBlockInformation* text_block_information = extract_block_information(text_block, !start_parse, y0, title_max_length, &glyphs);
+        page_extraction.text_blocks.push_back(std::move(*text_block_information));
+        delete text_block_information;
+
+        // if atleast 1 text block is page number block
+        if (page_extraction.text_blocks.back().is_page_number) {
+            start_parse = true; // first page that have page number
+        }
+    });
+}
+
+// append text blocks of 1 page to current section, push finished sections to pdf_document
+// block content and keywords are moved into the section
+static void assemble_text_block(TextBlockInformation&& text_block_information, PDFSection& pdf_section, PDFDocument& pdf_document) {
+    // only add blocks that is not page number
+    if (!(text_block_information.is_page_number)) {
+        if (text_block_information.title_format) {
+            if (pdf_section.title.length() > 0) {
+                pdf_section.content.trim();
+                pdf_document.sections.push_back(std::move(pdf_section));
+            }
 
-    if (userPW) {
-        delete userPW;
+            // first emphasized word is title, the rest are keywords
+            pdf_section = PDFSection();
+            pdf_section.title = std::move(text_block_information.emphasized_words.front());
+            pdf_section.title_format = text_block_information.title_format.value();
+            text_block_information.emphasized_words.pop_front();
+            pdf_section.emphasized_words = std::move(text_block_information.emphasized_words);
+            pdf_section.content.append(std::move(text_block_information.partial_paragraph_content));
+        } else if (pdf_section.title.length() > 0) {
+            pdf_section.emphasized_words.splice(pdf_section.emphasized_words.end(), text_block_information.emphasized_words);
+            pdf_section.content.append(std::move(text_block_information.partial_paragraph_content));
+        }
     }
+}
 
-    if (ownerPW) {
-        delete ownerPW;
+static void assemble_page_sections(std::list<TextBlockInformation>&& text_blocks, PDFSection& pdf_section, PDFDocument& pdf_document) {
+    AllocStageScope alloc_stage_scope(AllocStage::SECTION_ASSEMBLY);
+    TraceSpan trace_span("assemble_sections");
+    trace_span.arg("blocks", text_blocks.size());
+    for (TextBlockInformation& text_block_information : text_blocks) {
+        assemble_text_block(std::move(text_block_information), pdf_section, pdf_document);
     }
+}
 
-    return doc;
+// heading read from document outline, in document order
+struct OutlineHeading {
+    std::string title;
+    unsigned int level;
+    int page;
+    double top;  // from top of page, same as upside down coordinates of TextOutputDev
+};
+
+// text of a text block, characters are converted by block_character like extract_text_block_information, they are added to glyphs
+template <typename Block>
+static std::string extract_text_block_content(Block* text_block, int64_t& glyphs) {
+    std::string content;
+    for (auto* line = text_block->getLines(); line; line = line->getNext()) {
+        for (auto* word = line->getWords(); word; word = word->getNext()) {
+            int word_length = word->getLength();
+            glyphs += word_length;
+            for (int i = 0; i < word_length; ++i) {
+                content += block_character(word, i);
+            }
+            content += u8" ";
+        }
+    }
+    return content;
 }
 
-std::string parse_pdf_document(PDFDoc *doc) {
-    TextOutputDev* textOut;
-    unsigned int title_max_length = 100;
-    int page_footer_height = 60.0;
-    double resolution = 72.0;
+// resolve page and top of outline item's destination, named destinations are looked up in catalog
+static bool resolve_outline_destination(PDFDoc* doc, LinkAction* action, int& page, double& top) {
+    if (!action || action->getKind() != actionGoTo) {
+        return false;
+    }
 
-    // create text output device
-    if (doc->isOk()) {
-        textOut = new TextOutputDev(nullptr, gFalse, 0.0, gFalse, gFalse);
-    } else {
-        delete doc;
-        return "{}";
+    LinkGoTo* go_to = static_cast<LinkGoTo*>(action);
+    LinkDest* dest = go_to->getDest();
+    LinkDest* named_dest = nullptr;
+    if (!dest && go_to->getNamedDest()) {
+        named_dest = doc->findDest(go_to->getNamedDest());
+        dest = named_dest;
     }
 
-    // process if textOut is ok
-    if (textOut->isOk()) {
-        globalParams = new GlobalParams();
-//        globalParams->setTextPageBreaks(gTrue);
-//        globalParams->setErrQuiet(gFalse);
-        int number_of_pages = doc->getNumPages();
+    bool resolved = false;
+    if (dest && dest->isOk()) {
+        if (dest->isPageRef()) {
+            Ref page_ref = dest->getPageRef();
+            page = doc->findPage(page_ref.num, page_ref.gen);
+        } else {
+            page = dest->getPageNum();
+        }
 
-        PDFDocument pdf_document;
-        PDFSection pdf_section;
-        bool start_parse = false;
+        if (page >= 1 && page <= doc->getNumPages()) {
+            // destination is in user space, y grows upward, destinations without top point to top of page
+            PDFRectangle* page_mediabox = doc->getPage(page)->getMediaBox();
+            bool has_top = dest->getKind() == destFitR ||
+                           ((dest->getKind() == destXYZ || dest->getKind() == destFitH || dest->getKind() == destFitBH) && dest->getChangeTop());
+            top = has_top ? std::max(0.0, page_mediabox->y2 - dest->getTop()) : 0.0;
+            resolved = true;
+        }
+    }
 
-//        std::cout << "Parsing " << number_of_pages << " pages of " << argv[1] << std::endl;
+    delete named_dest;
+    return resolved;
+}
 
-        for (int page = 1; page <= number_of_pages; ++page) {
-            PDFRectangle* page_mediabox =  doc->getPage(page)->getMediaBox();
-            double y0 = page_mediabox->y2 - page_footer_height;
-            doc->displayPage(textOut, page, resolution, resolution, 0, gTrue, gFalse, gFalse);
+// recursive, return false if any item has no title or no destination in this document
+static bool read_outline_items(PDFDoc* doc, GooList* items, unsigned int level, std::vector<OutlineHeading>& headings) {
+    for (int i = 0; i < items->getLength(); ++i) {
+        OutlineItem* item = static_cast<OutlineItem*>(items->get(i));
+        OutlineHeading heading;
+        heading.level = level;
+        for (int c = 0; c < item->getTitleLength(); ++c) {
+            heading.title += UnicodeToUTF8(item->getTitle()[c]);
+        }
+        trim(heading.title);
+
+        if (heading.title.empty() || !resolve_outline_destination(doc, item->getAction(), heading.page, heading.top)) {
+            return false;
+        }
+        headings.push_back(std::move(heading));
+
+        if (item->hasKids()) {
+            // kids are only loaded while item is open
+            item->open();
+            GooList* kids = item->getKids();
+            bool kids_complete = !kids || read_outline_items(doc, kids, level + 1, headings);
+            item->close();
+            if (!kids_complete) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 
+// outline is complete if every item resolves to a position and positions follow document order
+static bool read_document_outline(PDFDoc* doc, std::vector<OutlineHeading>& headings) {
+    Outline* outline = doc->getOutline();
+    if (!outline || !outline->getItems() || outline->getItems()->getLength() == 0) {
+        return false;
+    }
 
-            TextPage* textPage = textOut->takeText();
-            std::list<TextBlockInformation*> text_block_information_list;
+    if (!read_outline_items(doc, outline->getItems(), 0, headings)) {
+        return false;
+    }
 
-            for (TextFlow* flow = textPage->getFlows(); flow; flow = flow->getNext()) {
-                for (TextBlock* text_block = flow->getBlocks(); text_block; text_block = text_block->getNext()) {
+    for (size_t i = 1; i < headings.size(); ++i) {
+        if (headings[i].page < headings[i - 1].page ||
+            (headings[i].page == headings[i - 1].page && headings[i].top < headings[i - 1].top)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-                    // must process text_block here as it'll expire after parsing page
-                    TextBlockInformation* text_block_information = extract_text_block_information(text_block, !start_parse, y0, title_max_length);
-                    text_block_information_list.push_back(text_block_information);
+// cut page content by heading destinations, no emphasis or title prefix analysis is needed
+static void assemble_outline_sections(PDFDoc* doc, OutputDev* output_dev, TextBackend backend, const std::vector<OutlineHeading>& headings,
+                                      double resolution, int page_footer_height, PDFDocument& pdf_document) {
+    std::vector<PDFSection*> sections;
+    for (const OutlineHeading& heading : headings) {
+        PDFSection pdf_section;
+        pdf_section.title = heading.title;
+        pdf_document.sections.push_back(std::move(pdf_section));
+        sections.push_back(&pdf_document.sections.back());
+    }
 
-                    // if atleast 1 text block is page number block
-                    if (text_block_information->is_page_number) {
-                        start_parse = true; // first page that have page number
-                    }
-                }
+    // content before first heading doesn't belong to any section
+    size_t next_heading = 0;
+    int number_of_pages = doc->getNumPages();
+    for (int page = headings.front().page; page <= number_of_pages; ++page) {
+        alloc_profiler_set_page(page);
+        PDFRectangle* page_mediabox =  doc->getPage(page)->getMediaBox();
+        double y0 = page_mediabox->y2 - page_footer_height;
+
+        for_each_text_block(doc, output_dev, backend, page, resolution, [&](auto* text_block, int64_t& glyphs) {
+            double xMinA, xMaxA, yMinA, yMaxA;
+            text_block->getBBox(&xMinA, &yMinA, &xMaxA, &yMaxA);
+            // page number and footer
+            if (yMinA >= y0) {
+                return;
             }
-            textPage->decRefCnt();
-
-            // after first page which has page number
-            if (start_parse) {
-                for (TextBlockInformation* text_block_information : text_block_information_list) {
-                    // only add blocks that is not page number
-                    if (!(text_block_information->is_page_number)) {
-                        if (text_block_information->title_format) {
-                            if (pdf_section.title.length() > 0) {
-                                trim(pdf_section.content);
-                                pdf_document.sections.push_back(pdf_section);
-                            }
 
-                            pdf_section.title = text_block_information->emphasized_words.front();
-                            pdf_section.title_format = text_block_information->title_format.value();
-                            text_block_information->emphasized_words.pop_front();
-                            pdf_section.emphasized_words = text_block_information->emphasized_words;
-                            pdf_section.content = text_block_information->partial_paragraph_content;
-                        } else if (pdf_section.title.length() > 0) {
-                            pdf_section.emphasized_words.insert(pdf_section.emphasized_words.end(), text_block_information->emphasized_words.begin(), text_block_information->emphasized_words.end());
-                            pdf_section.content += text_block_information->partial_paragraph_content;
-                        }
-                    }
-                }
+            // block starts next section if next heading's destination is above bottom of block
+            bool new_section = false;
+            while (next_heading < headings.size() &&
+                   (headings[next_heading].page < page ||
+                    (headings[next_heading].page == page && headings[next_heading].top < yMaxA))) {
+                ++next_heading;
+                new_section = true;
+            }
+            if (next_heading == 0) {
+                return;
             }
 
-            // cleanup
-            for (TextBlockInformation* text_block_information : text_block_information_list) {
-                delete text_block_information;
+            PDFSection* pdf_section = sections[next_heading - 1];
+            std::string content = extract_text_block_content(text_block, glyphs);
+            if (new_section && ltrim_copy(content).compare(0, pdf_section->title.length(), pdf_section->title) == 0) {
+                // cut title out of content
+                ltrim(content);
+                content.erase(0, pdf_section->title.length());
             }
+            pdf_section->content.append(std::move(content));
+        });
+    }
+
+    alloc_profiler_set_page(0);
+    for (PDFSection& pdf_section : pdf_document.sections) {
+        pdf_section.content.trim();
+    }
+}
+
+// outline levels give the tree directly
+static void build_outline_tree(const std::vector<OutlineHeading>& headings, PDFDocument& pdf_document, DocumentNode& doc_root) {
+    AllocStageScope alloc_stage_scope(AllocStage::TREE_BUILD);
+    TraceSpan trace_span("build_tree");
+    trace_span.arg("sections", pdf_document.sections.size());
+    // last node of each level, a heading is at most 1 level deeper than previous one
+    std::vector<DocumentNode*> level_nodes;
+    level_nodes.push_back(&doc_root);
+    std::vector<OutlineHeading>::const_iterator heading = headings.begin();
+    for (PDFSection& section : pdf_document.sections) {
+        level_nodes.resize(heading->level + 1);
+        DocumentNode* parent_node = level_nodes.back();
+        ++heading;
+
+        DocumentNode node;
+        node.main_section = &section;
+        node.parent_node = parent_node;
+        if (!parent_node->sub_sections) {
+            parent_node->sub_sections = std::list<DocumentNode>();
         }
+        parent_node->sub_sections.value().push_back(std::move(node));
+        level_nodes.push_back(&(parent_node->sub_sections.value().back()));
+    }
+}
 
-        if (pdf_section.title.length() > 0) {
-            trim(pdf_section.content);
-            pdf_document.sections.push_back(pdf_section);
-        }
-
-        // all sections in a list, construct a tree from pdf_document.sections
-        PDFSection root_section;
-        GooString *titleString = doc->getDocInfoTitle();
-        root_section.title = titleString->toStr();
-        delete titleString;
-        root_section.content = "";
-        root_section.id = 0;
-        DocumentNode doc_root;
-        doc_root.main_section = &root_section;
-        doc_root.parent_node = nullptr;
-        std::list<TitleFormat> title_format_stack;
-        DocumentNode* current_node = &doc_root;
-        for (PDFSection& section : pdf_document.sections) {
-            // if this section's title format hasn't appear in title_format_stack
-            std::list<TitleFormat>::iterator it = std::find(title_format_stack.begin(), title_format_stack.end(), section.title_format);
-
-            // create subnode
-            DocumentNode node;
-            node.main_section = &section;
-
-            if (it == title_format_stack.end()) { // not exist yet, create a subnode to add it to current node
-                // add to current node
-                if (!current_node->sub_sections) {
-                    current_node->sub_sections = std::list<DocumentNode>();
-                }
-                node.parent_node = current_node;
-                current_node->sub_sections.value().push_back(std::move(node));
+static std::string hex_string(const GooString* string) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (int i = 0; i < string->getLength(); ++i) {
+        unsigned char c = static_cast<unsigned char>(string->getCString()[i]);
+        hex += digits[c >> 4];
+        hex += digits[c & 0xf];
+    }
+    return hex;
+}
+
+// offset after last startxref keyword in the last 1024 bytes, same search as poppler, 0 if there is none
+static int64_t read_start_xref(PDFDoc* doc) {
+    BaseStream* stream = doc->getBaseStream();
+    std::string tail;
+    stream->setPos(1024, -1);
+    for (int i = 0, c; i < 1024 && (c = stream->getChar()) != EOF; ++i) {
+        tail += static_cast<char>(c);
+    }
+
+    size_t keyword = tail.rfind("startxref");
+    if (keyword == std::string::npos) {
+        return 0;
+    }
+    return std::strtoll(tail.c_str() + keyword + 9, nullptr, 10);
+}
+
+static DocumentRevision read_document_revision(PDFDoc* doc) {
+    DocumentRevision revision;
+    Object* trailer = doc->getXRef()->getTrailerDict();
+    if (trailer && trailer->isDict()) {
+        Object id = trailer->dictLookup("ID");
+        if (id.isArray() && id.arrayGetLength() == 2) {
+            Object permanent_id = id.arrayGet(0);
+            Object update_id = id.arrayGet(1);
+            if (permanent_id.isString() && update_id.isString()) {
+                revision.document_id = hex_string(permanent_id.getString());
+                revision.revision_id = hex_string(update_id.getString());
+            }
+        }
+
+        Object previous = trailer->dictLookup("Prev");
+        if (previous.isInt()) {
+            revision.previous_start_xref = previous.getInt();
+        } else if (previous.isInt64()) {
+            revision.previous_start_xref = previous.getInt64();
+        }
+    }
+    revision.start_xref = read_start_xref(doc);
+    return revision;
+}
+
+// find headings by emphasis and title prefix of text blocks, after first page which has page number
+static void assemble_heuristic_sections(PDFDoc* doc, OutputDev* output_dev, const ParseOptions& options, double resolution,
+                                        int page_footer_height, unsigned int title_max_length, PDFDocument& pdf_document) {
+    int number_of_pages = doc->getNumPages();
+    PDFSection pdf_section;
+    bool start_parse = false;
+    ParseState parse_state;
+
+//        std::cout << "Parsing " << number_of_pages << " pages of " << argv[1] << std::endl;
 
-                current_node = &(current_node->sub_sections.value().front());
-                title_format_stack.push_back(section.title_format);
+    for (int page = 1; page <= number_of_pages; ++page) {
+        PageExtraction page_extraction;
+        page_extraction.start_parse = start_parse;
+
+        // extraction of a page only depends on its objects and start_parse at its beginning,
+        // if both are unchanged since previous run, reuse its text blocks instead of displaying the page
+        bool reuse_previous_extraction = false;
+        if (options.incremental_state) {
+            page_extraction.fingerprint = page_object_fingerprint(doc, page);
+            std::vector<PageExtraction>& previous_pages = options.incremental_state->pages;
+            if (static_cast<size_t>(page) <= previous_pages.size() &&
+                previous_pages[page - 1].fingerprint == page_extraction.fingerprint &&
+                previous_pages[page - 1].start_parse == page_extraction.start_parse) {
+                page_extraction.text_blocks = std::move(previous_pages[page - 1].text_blocks);
+                reuse_previous_extraction = true;
+            }
+        }
+
+        if (!reuse_previous_extraction) {
+            extract_page_text_blocks(doc, output_dev, options.backend, page, resolution, page_footer_height, title_max_length, page_extraction);
+            ++parse_state.extracted_pages;
+        }
+
+        for (const TextBlockInformation& text_block_information : page_extraction.text_blocks) {
+            if (text_block_information.is_page_number) {
+                start_parse = true;
+            }
+        }
+
+        // after first page which has page number, blocks kept in incremental state are copied
+        if (start_parse) {
+            if (options.incremental_state) {
+                assemble_page_sections(std::list<TextBlockInformation>(page_extraction.text_blocks), pdf_section, pdf_document);
             } else {
-                // Up until this title_format is the last element
-                // save the iterator
-                std::list<TitleFormat>::iterator tmp_it = it;
-                // it modified
-                while (it != title_format_stack.end()){
-                    current_node = current_node->parent_node;
-                    ++it;
-                }
-                // it = end() here
-                ++tmp_it;
-                title_format_stack.erase(tmp_it, it);
+                assemble_page_sections(std::move(page_extraction.text_blocks), pdf_section, pdf_document);
+            }
+        }
+
+        if (options.incremental_state) {
+            parse_state.pages.push_back(std::move(page_extraction));
+        }
+    }
+
+    if (options.incremental_state) {
+        parse_state.backend = options.backend;
+        parse_state.revision = read_document_revision(doc);
+        *options.incremental_state = std::move(parse_state);
+    }
 
-                node.parent_node = current_node;
+    alloc_profiler_set_page(0);
+    AllocStageScope alloc_stage_scope(AllocStage::SECTION_ASSEMBLY);
+    if (pdf_section.title.length() > 0) {
+        pdf_section.content.trim();
+        pdf_document.sections.push_back(std::move(pdf_section));
+    }
+}
 
-                current_node->sub_sections.value().push_back(std::move(node));
-                current_node = &(current_node->sub_sections.value().back());
+// title formats seen so far are levels of the tree
+static void build_title_format_tree(PDFDocument& pdf_document, DocumentNode& doc_root) {
+    AllocStageScope alloc_stage_scope(AllocStage::TREE_BUILD);
+    TraceSpan trace_span("build_tree");
+    trace_span.arg("sections", pdf_document.sections.size());
+    std::list<TitleFormat> title_format_stack;
+    DocumentNode* current_node = &doc_root;
+    for (PDFSection& section : pdf_document.sections) {
+        // if this section's title format hasn't appear in title_format_stack
+        std::list<TitleFormat>::iterator it = std::find(title_format_stack.begin(), title_format_stack.end(), section.title_format);
+
+        // create subnode
+        DocumentNode node;
+        node.main_section = &section;
+
+        if (it == title_format_stack.end()) { // not exist yet, create a subnode to add it to current node
+            // add to current node
+            if (!current_node->sub_sections) {
+                current_node->sub_sections = std::list<DocumentNode>();
             }
+            node.parent_node = current_node;
+            current_node->sub_sections.value().push_back(std::move(node));
+
+            current_node = &(current_node->sub_sections.value().front());
+            title_format_stack.push_back(section.title_format);
+        } else {
+            // Up until this title_format is the last element
+            // save the iterator
+            std::list<TitleFormat>::iterator tmp_it = it;
+            // it modified
+            while (it != title_format_stack.end()){
+                current_node = current_node->parent_node;
+                ++it;
+            }
+            // it = end() here
+            ++tmp_it;
+            title_format_stack.erase(tmp_it, it);
+
+            node.parent_node = current_node;
+
+            current_node->sub_sections.value().push_back(std::move(node));
+            current_node = &(current_node->sub_sections.value().back());
+        }
+    }
+}
+
+// pages before first page number of the shard are kept unassembled, since start_parse of earlier pages is unknown,
+// extraction itself doesn't depend on it: footer blocks have no content whether they are analyzed as page number or not
+static void assemble_shard_page(std::list<TextBlockInformation>& text_blocks, PDFShard& shard, PDFDocument& shard_document) {
+    AllocStageScope alloc_stage_scope(AllocStage::SECTION_ASSEMBLY);
+    TraceSpan trace_span("assemble_sections");
+    trace_span.arg("blocks", text_blocks.size());
+    for (const TextBlockInformation& text_block_information : text_blocks) {
+        if (text_block_information.is_page_number) {
+            shard.start_parse = true;
+        }
+    }
+
+    if (!shard.start_parse) {
+        shard.pending_text_blocks.splice(shard.pending_text_blocks.end(), text_blocks);
+        return;
+    }
+
+    for (TextBlockInformation& text_block_information : text_blocks) {
+        // title is found once trailing section has one
+        if (shard.trailing_section.title.empty() && !text_block_information.title_format) {
+            if (!text_block_information.is_page_number) {
+                shard.leading_section.emphasized_words.splice(shard.leading_section.emphasized_words.end(), text_block_information.emphasized_words);
+                shard.leading_section.content.append(std::move(text_block_information.partial_paragraph_content));
+            }
+        } else {
+            assemble_text_block(std::move(text_block_information), shard.trailing_section, shard_document);
+        }
+    }
+}
+
+static void assemble_shard_sections(PDFDoc* doc, OutputDev* output_dev, TextBackend backend, double resolution, int page_footer_height,
+                                    unsigned int title_max_length, PDFShard& shard) {
+    PDFDocument shard_document;
+    for (int page = shard.first_page; page <= shard.last_page; ++page) {
+        PageExtraction page_extraction;
+        page_extraction.start_parse = shard.start_parse;
+        extract_page_text_blocks(doc, output_dev, backend, page, resolution, page_footer_height, title_max_length, page_extraction);
+        assemble_shard_page(page_extraction.text_blocks, shard, shard_document);
+    }
+    alloc_profiler_set_page(0);
+    shard.sections = std::move(shard_document.sections);
+}
+
+static void write_pdf_shard(const PDFShard& shard, std::ostream& output) {
+    AllocStageScope alloc_stage_scope(AllocStage::SERIALIZATION);
+    TraceSpan trace_span("serialize");
+    nlohmann::json json_shard;
+    json_shard["version"] = PDF_SHARD_VERSION;
+    json_shard["backend"] = text_backend_name(shard.backend);
+    json_shard["first_page"] = shard.first_page;
+    json_shard["last_page"] = shard.last_page;
+    json_shard["number_of_pages"] = shard.number_of_pages;
+    json_shard["title"] = shard.document_title;
+    json_shard["start_parse"] = shard.start_parse;
+    json_shard["pending_blocks"] = nlohmann::json::array();
+    for (const TextBlockInformation& text_block_information : shard.pending_text_blocks) {
+        json_shard["pending_blocks"].push_back(text_block_to_json(text_block_information));
+    }
+    json_shard["leading_section"] = section_to_json(shard.leading_section);
+    json_shard["trailing_section"] = section_to_json(shard.trailing_section);
+
+    // sections are written one by one, like write_json_node_list
+    std::string json_shard_string = json_shard.dump();
+    json_shard_string.pop_back();
+    output << json_shard_string << ",\"sections\":[";
+    bool first_section = true;
+    for (const PDFSection& pdf_section : shard.sections) {
+        if (!first_section) {
+            output << ',';
+        }
+        output << section_to_json(pdf_section).dump();
+        first_section = false;
+    }
+    output << "]}";
+}
+
+bool parse_pdf_document(PDFDoc *doc, std::ostream& output, const ParseOptions& options) {
+    OutputDev* textOut;
+    bool textOutOk = true;
+    unsigned int title_max_length = 100;
+    int page_footer_height = 60.0;
+    double resolution = 72.0;
+
+    // create text output device
+    if (doc->isOk()) {
+        if (options.backend == TextBackend::GLYPH_COLLECTOR) {
+            textOut = new GlyphCollectorOutputDev();
+        } else {
+            TextOutputDev* textOutputDev = new TextOutputDev(nullptr, gFalse, 0.0, gFalse, gFalse);
+            textOutOk = textOutputDev->isOk();
+            textOut = textOutputDev;
         }
+    } else {
+        delete doc;
+        output << "{}";
+        return false;
+    }
+
+    // process if textOut is ok
+    if (textOutOk) {
+        globalParams = new GlobalParams();
+//        globalParams->setTextPageBreaks(gTrue);
+//        globalParams->setErrQuiet(gFalse);
+
+        if (options.first_page > 0 || options.last_page > 0) {
+            PDFShard shard;
+            shard.backend = options.backend;
+            shard.number_of_pages = doc->getNumPages();
+            shard.first_page = std::max(options.first_page, 1);
+            shard.last_page = options.last_page > 0 ? std::min(options.last_page, shard.number_of_pages) : shard.number_of_pages;
+            GooString *titleString = doc->getDocInfoTitle();
+            shard.document_title = titleString->toStr();
+            delete titleString;
+
+            assemble_shard_sections(doc, textOut, options.backend, resolution, page_footer_height, title_max_length, shard);
+            write_pdf_shard(shard, output);
+        } else {
+            PDFDocument pdf_document;
+
+            // all sections in a list, construct a tree from pdf_document.sections
+            PDFSection root_section;
+            GooString *titleString = doc->getDocInfoTitle();
+            root_section.title = titleString->toStr();
+            delete titleString;
+            root_section.content = "";
+            root_section.id = 0;
+            DocumentNode doc_root;
+            doc_root.main_section = &root_section;
+            doc_root.parent_node = nullptr;
+
+            std::vector<OutlineHeading> outline_headings;
+            if (options.use_outline && read_document_outline(doc, outline_headings)) {
+                // complete outline already names every heading, its level and position
+                assemble_outline_sections(doc, textOut, options.backend, outline_headings, resolution, page_footer_height, pdf_document);
+                build_outline_tree(outline_headings, pdf_document, doc_root);
+            } else {
+                assemble_heuristic_sections(doc, textOut, options, resolution, page_footer_height, title_max_length, pdf_document);
+                build_title_format_tree(pdf_document, doc_root);
+            }
 
-        // present as tree
-        // nlohmann::json json_pdf_document = add_json_node(doc_root);
+            // present as tree
+            // nlohmann::json json_pdf_document = add_json_node(doc_root);
 
-        // present as list
-        nlohmann::json json_pdf_document = add_json_node_list(doc_root);
+            // present as list
+            write_json_node_list(doc_root, output);
+        }
 
         delete textOut;
         delete doc;
         delete globalParams;
-        return json_pdf_document.dump();
+        return true;
     } else {
         delete textOut;
         delete doc;
-        return "{}";
+        output << "{}";
+        return false;
     }
 }
 
@@ -672,3 +1295,268 @@ inline void print_all_fonts(PDFDoc *doc)
       delete fonts;
     }
 }
+
+// FNV-1a, stable across runs and platforms so it can be saved in parse state
+static void add_to_fingerprint(uint64_t& fingerprint, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        fingerprint ^= (value >> (i * 8)) & 0xff;
+        fingerprint *= 0x100000001b3ULL;
+    }
+}
+
+// collect indirect references in a direct object, back references to parent/page are skipped
+static void collect_object_refs(const Object& object, std::list<Ref>& refs) {
+    if (object.isRef()) {
+        refs.push_back(object.getRef());
+    } else if (object.isArray()) {
+        for (int i = 0; i < object.arrayGetLength(); ++i) {
+            collect_object_refs(object.arrayGetNF(i), refs);
+        }
+    } else if (object.isDict() || object.isStream()) {
+        Dict* dict = object.isDict() ? object.getDict() : object.streamGetDict();
+        for (int i = 0; i < dict->getLength(); ++i) {
+            const char* key = dict->getKey(i);
+            if (std::strcmp(key, "Parent") != 0 && std::strcmp(key, "P") != 0 &&
+                std::strcmp(key, "Dest") != 0 && std::strcmp(key, "A") != 0) {
+                collect_object_refs(dict->getValNF(i), refs);
+            }
+        }
+    }
+}
+
+uint64_t page_object_fingerprint(PDFDoc* doc, int page) {
+    XRef* xref = doc->getXRef();
+    Page* pdf_page = doc->getPage(page);
+    uint64_t fingerprint = 0xcbf29ce484222325ULL;
+
+    // media box and rotation may be inherited through /Parent which isn't followed below
+    PDFRectangle* page_mediabox = pdf_page->getMediaBox();
+    for (double coordinate : {page_mediabox->x1, page_mediabox->y1, page_mediabox->x2, page_mediabox->y2}) {
+        add_to_fingerprint(fingerprint, static_cast<uint64_t>(std::llround(coordinate * 1000)));
+    }
+    add_to_fingerprint(fingerprint, static_cast<uint64_t>(pdf_page->getRotate()));
+
+    // resources may be inherited from page tree, start from both page dict and resolved resources
+    std::list<Ref> refs;
+    refs.push_back(pdf_page->getRef());
+    if (Dict* resource_dict = pdf_page->getResourceDict()) {
+        for (int i = 0; i < resource_dict->getLength(); ++i) {
+            collect_object_refs(resource_dict->getValNF(i), refs);
+        }
+    }
+
+    std::unordered_set<uint64_t> visited_refs;
+    while (!refs.empty()) {
+        Ref ref = refs.front();
+        refs.pop_front();
+        uint64_t ref_key = (static_cast<uint64_t>(static_cast<uint32_t>(ref.num)) << 32) | static_cast<uint32_t>(ref.gen);
+        if (!visited_refs.insert(ref_key).second) {
+            continue;
+        }
+
+        // an incremental update rewrites a changed object at a new offset
+        XRefEntry* entry = xref->getEntry(ref.num, gFalse);
+        add_to_fingerprint(fingerprint, ref_key);
+        if (entry) {
+            add_to_fingerprint(fingerprint, static_cast<uint64_t>(entry->offset));
+            add_to_fingerprint(fingerprint, static_cast<uint64_t>(entry->type));
+        }
+
+        collect_object_refs(xref->fetch(ref.num, ref.gen), refs);
+    }
+
+    return fingerprint;
+}
+
+// saved revision is either current revision or the one current revision updates incrementally,
+// a rewritten file or another document has another /ID or no /Prev pointing at saved xref
+static bool is_same_or_next_revision(const DocumentRevision& saved, const DocumentRevision& current) {
+    if (saved.document_id != current.document_id || saved.start_xref == 0) {
+        return false;
+    }
+    if (saved.start_xref == current.start_xref) {
+        return saved.revision_id == current.revision_id;
+    }
+    return saved.start_xref == current.previous_start_xref;
+}
+
+bool load_parse_state(const std::string& file_name, PDFDoc* doc, ParseState& state) {
+    std::ifstream state_file(file_name);
+    if (!state_file || !doc->isOk()) {
+        return false;
+    }
+
+    nlohmann::json json_state = nlohmann::json::parse(state_file, nullptr, false);
+    // value() throws on json that isn't an object
+    if (json_state.is_discarded() || !json_state.is_object() || json_state.value("version", 0) != PARSE_STATE_VERSION) {
+        return false;
+    }
+
+    try {
+        state.pages.clear();
+        if (parse_text_backend(json_state.at("backend")) != state.backend) {
+            return false;
+        }
+        DocumentRevision saved_revision;
+        saved_revision.document_id = json_state.at("document_id");
+        saved_revision.revision_id = json_state.at("revision_id");
+        saved_revision.start_xref = json_state.at("start_xref");
+        if (!is_same_or_next_revision(saved_revision, read_document_revision(doc))) {
+            return false;
+        }
+        state.revision = saved_revision;
+        for (const nlohmann::json& json_page : json_state.at("pages")) {
+            PageExtraction page_extraction;
+            page_extraction.fingerprint = json_page.at("fingerprint");
+            page_extraction.start_parse = json_page.at("start_parse");
+            for (const nlohmann::json& json_block : json_page.at("blocks")) {
+                page_extraction.text_blocks.push_back(text_block_from_json(json_block));
+            }
+            state.pages.push_back(std::move(page_extraction));
+        }
+    } catch (const nlohmann::json::exception&) {
+        // state of another format, do full parse
+        state.pages.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool save_parse_state(const std::string& file_name, const ParseState& state) {
+    std::ofstream state_file(file_name);
+    nlohmann::json json_header;
+    json_header["version"] = PARSE_STATE_VERSION;
+    json_header["backend"] = text_backend_name(state.backend);
+    json_header["document_id"] = state.revision.document_id;
+    json_header["revision_id"] = state.revision.revision_id;
+    json_header["start_xref"] = state.revision.start_xref;
+    // header is an object without closing brace, pages follow
+    std::string json_header_string = json_header.dump();
+    json_header_string.pop_back();
+    state_file << json_header_string << ",\"pages\":[";
+    bool first_page = true;
+    for (const PageExtraction& page_extraction : state.pages) {
+        nlohmann::json json_page;
+        json_page["fingerprint"] = page_extraction.fingerprint;
+        json_page["start_parse"] = page_extraction.start_parse;
+        json_page["blocks"] = nlohmann::json::array();
+        for (const TextBlockInformation& text_block_information : page_extraction.text_blocks) {
+            json_page["blocks"].push_back(text_block_to_json(text_block_information));
+        }
+
+        // pages are written one by one, state of big document isn't dumped at once
+        if (!first_page) {
+            state_file << ',';
+        }
+        state_file << json_page.dump();
+        first_page = false;
+    }
+    state_file << "]}";
+    return state_file.good();
+}
+
+bool load_pdf_shard(const std::string& file_name, PDFShard& shard) {
+    TraceSpan trace_span("load_shard");
+    std::ifstream shard_file(file_name);
+    if (!shard_file) {
+        return false;
+    }
+
+    nlohmann::json json_shard = nlohmann::json::parse(shard_file, nullptr, false);
+    if (json_shard.is_discarded() || !json_shard.is_object() || json_shard.value("version", 0) != PDF_SHARD_VERSION) {
+        return false;
+    }
+
+    try {
+        std::optional<TextBackend> backend = parse_text_backend(json_shard.at("backend"));
+        if (!backend) {
+            return false;
+        }
+        shard.backend = backend.value();
+        shard.first_page = json_shard.at("first_page");
+        shard.last_page = json_shard.at("last_page");
+        shard.number_of_pages = json_shard.at("number_of_pages");
+        shard.document_title = json_shard.at("title");
+        shard.start_parse = json_shard.at("start_parse");
+        for (const nlohmann::json& json_block : json_shard.at("pending_blocks")) {
+            shard.pending_text_blocks.push_back(text_block_from_json(json_block));
+        }
+        shard.leading_section = section_from_json(json_shard.at("leading_section"));
+        for (const nlohmann::json& json_section : json_shard.at("sections")) {
+            shard.sections.push_back(section_from_json(json_section));
+        }
+        shard.trailing_section = section_from_json(json_shard.at("trailing_section"));
+    } catch (const nlohmann::json::exception&) {
+        return false;
+    }
+
+    return true;
+}
+
+bool merge_pdf_shards(const std::vector<std::string>& shard_file_names, std::ostream& output) {
+    std::vector<PDFShard> shards(shard_file_names.size());
+    for (size_t i = 0; i < shard_file_names.size(); ++i) {
+        if (!load_pdf_shard(shard_file_names[i], shards[i])) {
+            return false;
+        }
+    }
+
+    // shards must cover every page of the document exactly once
+    std::sort(shards.begin(), shards.end(), [](const PDFShard& a, const PDFShard& b) {
+        return a.first_page < b.first_page;
+    });
+    if (shards.empty() || shards.front().first_page != 1 || shards.back().last_page != shards.back().number_of_pages) {
+        return false;
+    }
+    for (size_t i = 1; i < shards.size(); ++i) {
+        if (shards[i].first_page != shards[i - 1].last_page + 1 || shards[i].number_of_pages != shards[0].number_of_pages ||
+            shards[i].backend != shards[0].backend) {
+            return false;
+        }
+    }
+
+    // replay section assembly of parse_pdf_document at shard edges
+    PDFDocument pdf_document;
+    PDFSection pdf_section;
+    bool start_parse = false;
+    for (PDFShard& shard : shards) {
+        if (start_parse) {
+            assemble_page_sections(std::move(shard.pending_text_blocks), pdf_section, pdf_document);
+        }
+
+        if (shard.start_parse) {
+            start_parse = true;
+            if (pdf_section.title.length() > 0) {
+                pdf_section.emphasized_words.splice(pdf_section.emphasized_words.end(), shard.leading_section.emphasized_words);
+                pdf_section.content.append(std::move(shard.leading_section.content));
+            }
+
+            // first title of the shard ends the section left open by earlier shards
+            if (shard.trailing_section.title.length() > 0) {
+                if (pdf_section.title.length() > 0) {
+                    pdf_section.content.trim();
+                    pdf_document.sections.push_back(std::move(pdf_section));
+                }
+                pdf_document.sections.splice(pdf_document.sections.end(), shard.sections);
+                pdf_section = std::move(shard.trailing_section);
+            }
+        }
+    }
+
+    if (pdf_section.title.length() > 0) {
+        pdf_section.content.trim();
+        pdf_document.sections.push_back(std::move(pdf_section));
+    }
+
+    PDFSection root_section;
+    root_section.title = shards.front().document_title;
+    root_section.content = "";
+    root_section.id = 0;
+    DocumentNode doc_root;
+    doc_root.main_section = &root_section;
+    doc_root.parent_node = nullptr;
+    build_title_format_tree(pdf_document, doc_root);
+    write_json_node_list(doc_root, output);
+    return true;
+}
@@ -0,0 +1,120 @@
+#include "trace_events.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+std::atomic<bool> trace_events_recording{false};
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int arg_count;
+    const char* arg_keys[TRACE_EVENT_MAX_ARGS];
+    int64_t arg_values[TRACE_EVENT_MAX_ARGS];
+};
+
+// events of 1 thread, written only by its thread, owned by the registry so they outlive the thread
+struct ThreadTraceBuffer {
+    unsigned int thread_id;
+    const char* thread_name = nullptr;
+    std::vector<TraceEvent> events;
+    uint64_t recorded = 0;  // total events, index of next event is recorded % events.size()
+};
+
+static std::chrono::steady_clock::time_point trace_start;
+static std::mutex thread_buffers_mutex;
+static std::vector<std::unique_ptr<ThreadTraceBuffer>> thread_buffers;
+static thread_local ThreadTraceBuffer* current_thread_buffer = nullptr;
+
+// allocated on first event of each thread, recording itself never allocates
+static ThreadTraceBuffer* get_thread_buffer() {
+    if (!current_thread_buffer) {
+        std::unique_ptr<ThreadTraceBuffer> thread_buffer = std::make_unique<ThreadTraceBuffer>();
+        thread_buffer->events.resize(TRACE_EVENTS_PER_THREAD);
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        thread_buffer->thread_id = static_cast<unsigned int>(thread_buffers.size()) + 1;
+        current_thread_buffer = thread_buffer.get();
+        thread_buffers.push_back(std::move(thread_buffer));
+    }
+    return current_thread_buffer;
+}
+
+void trace_events_enable() {
+    trace_start = std::chrono::steady_clock::now();
+    trace_events_recording.store(true);
+}
+
+void trace_set_thread_name(const char* name) {
+    if (trace_events_enabled()) {
+        get_thread_buffer()->thread_name = name;
+    }
+}
+
+uint64_t TraceSpan::trace_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start).count();
+}
+
+void TraceSpan::record() {
+    uint64_t end_ns = trace_now_ns();
+    ThreadTraceBuffer* thread_buffer = get_thread_buffer();
+    TraceEvent& event = thread_buffer->events[thread_buffer->recorded % thread_buffer->events.size()];
+    event.name = name;
+    event.start_ns = start_ns;
+    event.duration_ns = end_ns - start_ns;
+    event.arg_count = arg_count;
+    for (int i = 0; i < arg_count; ++i) {
+        event.arg_keys[i] = arg_keys[i];
+        event.arg_values[i] = arg_values[i];
+    }
+    ++thread_buffer->recorded;
+}
+
+bool write_trace_events(std::ostream& output) {
+    trace_events_recording.store(false);
+
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+    uint64_t dropped_events = 0;
+    bool first_event = true;
+    output << "{\"traceEvents\":[";
+    for (const std::unique_ptr<ThreadTraceBuffer>& thread_buffer : thread_buffers) {
+        if (thread_buffer->thread_name) {
+            nlohmann::json json_metadata;
+            json_metadata["name"] = "thread_name";
+            json_metadata["ph"] = "M";
+            json_metadata["pid"] = 1;
+            json_metadata["tid"] = thread_buffer->thread_id;
+            json_metadata["args"]["name"] = thread_buffer->thread_name;
+            output << (first_event ? "" : ",") << json_metadata.dump();
+            first_event = false;
+        }
+
+        // oldest kept event first
+        uint64_t capacity = thread_buffer->events.size();
+        uint64_t first = thread_buffer->recorded > capacity ? thread_buffer->recorded - capacity : 0;
+        dropped_events += first;
+        for (uint64_t i = first; i < thread_buffer->recorded; ++i) {
+            const TraceEvent& event = thread_buffer->events[i % capacity];
+            nlohmann::json json_event;
+            json_event["name"] = event.name;
+            json_event["ph"] = "X";
+            json_event["pid"] = 1;
+            json_event["tid"] = thread_buffer->thread_id;
+            // microseconds
+            json_event["ts"] = event.start_ns / 1000.0;
+            json_event["dur"] = event.duration_ns / 1000.0;
+            if (event.arg_count > 0) {
+                for (int a = 0; a < event.arg_count; ++a) {
+                    json_event["args"][event.arg_keys[a]] = event.arg_values[a];
+                }
+            }
+            output << (first_event ? "" : ",") << json_event.dump();
+            first_event = false;
+        }
+    }
+    output << "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped_events << "}}" << std::endl;
+    return output.good();
+}